@@ -1,6 +1,9 @@
 #include "config.hpp"
+#include <app/cpu.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <sstream>
 
@@ -84,7 +87,105 @@ void config::parse(const std::filesystem::path& file)
   boost::property_tree::ini_parser::read_ini(ss, pt);
   server.address = pt.get<std::string>("server.address", "0.0.0.0");
   server.service = pt.get<std::string>("server.service", "8080");
+  server.workers = pt.get<std::size_t>("server.workers", server.workers);
   server.proxied = pt.get<bool>("server.proxied", false);
+  server.trusted = pt.get<std::string>("server.trusted", "");
+  server.wait = std::chrono::milliseconds{ pt.get<std::size_t>("server.wait", server.wait.count()) };
+  server.prewarm = pt.get<bool>("server.prewarm", server.prewarm);
+  server.backlog = pt.get<int>("server.backlog", server.backlog);
+  server.nodelay = pt.get<bool>("server.nodelay", server.nodelay);
+  server.defer_accept = std::chrono::seconds{ pt.get<int>("server.defer_accept", 0) };
+  server.fastopen = pt.get<int>("server.fastopen", server.fastopen);
+  server.sndbuf = pt.get<int>("server.sndbuf", server.sndbuf);
+  server.rcvbuf = pt.get<int>("server.rcvbuf", server.rcvbuf);
+  server.notsent_lowat = pt.get<int>("server.notsent_lowat", server.notsent_lowat);
+  server.busy_poll = std::chrono::microseconds{ pt.get<int>("server.busy_poll", 0) };
+  for (const auto& [key, section] : pt) {
+    if (!key.starts_with("vhost.")) {
+      continue;
+    }
+    vhost vhost;
+    vhost.name = key.substr(6);
+    std::istringstream is(section.get<std::string>("hosts", ""));
+    for (std::string host; is >> host;) {
+      std::transform(host.begin(), host.end(), host.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+      });
+      if (host.find('*') != std::string::npos && (!host.starts_with("*.") || host.find('*', 1) != std::string::npos)) {
+        throw std::runtime_error("Invalid vhost wildcard (" + host + ")");
+      }
+      vhost.hosts.push_back(std::move(host));
+    }
+    if (vhost.hosts.empty()) {
+      throw std::runtime_error("Missing vhost hosts (" + vhost.name + ")");
+    }
+    if (section.get_child_optional("html")) {
+      vhost.html = section.get<std::filesystem::path>("html");
+      if (vhost.html->is_relative()) {
+        vhost.html = std::filesystem::absolute(file.parent_path() / *vhost.html);
+      }
+    }
+    if (section.get_child_optional("data")) {
+      vhost.data = section.get<std::filesystem::path>("data");
+      if (vhost.data->is_relative()) {
+        vhost.data = std::filesystem::absolute(file.parent_path() / *vhost.data);
+      }
+    }
+    vhost.cache = section.get<std::string>("cache", "");
+    vhost.proxied = section.get<bool>("proxied", server.proxied);
+    vhosts.push_back(std::move(vhost));
+  }
+  if (const auto section = pt.get_child_optional("mime")) {
+    for (const auto& [key, value] : *section) {
+      if (key == "file") {
+        mime.file = value.get_value<std::filesystem::path>();
+        if (mime.file->is_relative()) {
+          mime.file = std::filesystem::absolute(file.parent_path() / *mime.file);
+        }
+        continue;
+      }
+      if (key == "precompressed") {
+        mime.precompressed = value.get_value<bool>();
+        continue;
+      }
+      if (key == "sendfile") {
+        mime.sendfile = value.get_value<std::uint64_t>();
+        continue;
+      }
+      mime::type type;
+      type.extension = key;
+      std::transform(type.extension.begin(), type.extension.end(), type.extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+      });
+      std::istringstream is(value.get_value<std::string>());
+      if (type.extension.empty() || type.extension.find_first_of("./") != std::string::npos || !(is >> type.name) ||
+        type.name.find('/') == std::string::npos)
+      {
+        throw std::runtime_error("Invalid mime type (" + key + ")");
+      }
+      for (std::string option; is >> option;) {
+        if (option == "compress" || option == "nocompress") {
+          type.compress = option == "compress";
+        } else if (option == "sendfile" || option == "nosendfile") {
+          type.sendfile = option == "sendfile";
+        } else if (option.starts_with("max-age=")) {
+          const auto digits = std::string_view{ option }.substr(8);
+          std::uint64_t seconds = 0;
+          const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), seconds);
+          if (digits.empty() || error != std::errc{} || end != digits.data() + digits.size()) {
+            throw std::runtime_error("Invalid mime type max-age (" + key + ")");
+          }
+          type.max_age = std::chrono::seconds{ seconds };
+        } else {
+          throw std::runtime_error("Invalid mime type option (" + key + " " + option + ")");
+        }
+      }
+      mime.types.push_back(std::move(type));
+    }
+  }
+  cpu.server = parse_cpus(pt.get<std::string>("cpu.server", ""));
+  cpu.logger = parse_cpus(pt.get<std::string>("cpu.logger", ""));
+  cpu.background = parse_cpus(pt.get<std::string>("cpu.background", ""));
   if (pt.get_child_optional("log.filename")) {
     log.filename = pt.get<std::filesystem::path>("log.filename");
     if (log.filename->is_relative()) {
@@ -92,6 +193,126 @@ void config::parse(const std::filesystem::path& file)
     }
   }
   log.severity = pt.get<spdlog::level::level_enum>("log.severity", log.severity);
+  if (pt.get_child_optional("upload.directory")) {
+    upload.directory = pt.get<std::string>("upload.directory");
+    if (upload.directory->empty() || upload.directory->find("..") != std::string::npos) {
+      throw std::runtime_error("Invalid upload directory (" + *upload.directory + ")");
+    }
+  }
+  upload.size = pt.get<std::uint64_t>("upload.size", upload.size);
+  if (pt.get_child_optional("store.filename")) {
+    store.filename = pt.get<std::filesystem::path>("store.filename");
+    if (store.filename->is_relative()) {
+      store.filename = std::filesystem::absolute(file.parent_path() / *store.filename);
+    }
+  }
+  store.capacity = pt.get<std::size_t>("store.capacity", store.capacity);
+  if (store.filename && server.workers) {
+    throw std::runtime_error("Store requires a single process (workers = 0)");
+  }
+  websocket.queue = pt.get<std::size_t>("websocket.queue", websocket.queue);
+  websocket.bytes = pt.get<std::size_t>("websocket.bytes", websocket.bytes);
+  websocket.publish = pt.get<bool>("websocket.publish", websocket.publish);
+  if (const auto section = pt.get_child_optional("limit")) {
+    for (const auto& [key, value] : *section) {
+      if (key == "size") {
+        limit.size = value.get_value<std::size_t>();
+        continue;
+      }
+      if (key.empty() || key[0] != '/') {
+        throw std::runtime_error("Invalid limit route (" + key + ")");
+      }
+      limit::route route;
+      route.prefix = key;
+      std::istringstream is(value.get_value<std::string>());
+      if (!(is >> route.rate)) {
+        throw std::runtime_error("Invalid limit rate (" + key + ")");
+      }
+      is >> route.burst >> route.bandwidth;
+      limit.routes.push_back(std::move(route));
+    }
+  }
+  if (const auto section = pt.get_child_optional("upstream")) {
+    for (const auto& [key, value] : *section) {
+      if (key == "balance") {
+        const auto balance = value.get_value<std::string>();
+        if (balance != "round_robin" && balance != "least_outstanding") {
+          throw std::runtime_error("Invalid upstream balance (" + balance + ")");
+        }
+        upstream.least_outstanding = balance == "least_outstanding";
+        continue;
+      }
+      if (key == "connections") {
+        upstream.connections = value.get_value<std::size_t>();
+        continue;
+      }
+      if (key == "timeout") {
+        upstream.timeout = std::chrono::milliseconds{ value.get_value<std::size_t>() };
+        continue;
+      }
+      if (key == "fail_timeout") {
+        upstream.fail_timeout = std::chrono::milliseconds{ value.get_value<std::size_t>() };
+        continue;
+      }
+      if (key.empty() || key[0] != '/') {
+        throw std::runtime_error("Invalid upstream route (" + key + ")");
+      }
+      upstream::route route;
+      route.prefix = key;
+      std::istringstream is(value.get_value<std::string>());
+      for (std::string backend; is >> backend;) {
+        if (backend.rfind(':') == std::string::npos) {
+          throw std::runtime_error("Invalid upstream backend (" + backend + ")");
+        }
+        route.backends.push_back(backend);
+      }
+      if (route.backends.empty()) {
+        throw std::runtime_error("Missing upstream backends (" + key + ")");
+      }
+      upstream.routes.push_back(std::move(route));
+    }
+  }
+  if (const auto section = pt.get_child_optional("cache")) {
+    for (const auto& [key, value] : *section) {
+      if (key == "size") {
+        cache.size = value.get_value<std::size_t>();
+        continue;
+      }
+      if (key == "entry") {
+        cache.entry = value.get_value<std::size_t>();
+        continue;
+      }
+      if (key.empty() || key[0] != '/') {
+        throw std::runtime_error("Invalid cache route (" + key + ")");
+      }
+      cache::route route;
+      route.prefix = key;
+      std::istringstream is(value.get_value<std::string>());
+      std::size_t ttl = 0;
+      std::size_t stale = 0;
+      if (!(is >> ttl) || !ttl) {
+        throw std::runtime_error("Invalid cache ttl (" + key + ")");
+      }
+      is >> stale;
+      route.ttl = std::chrono::milliseconds{ ttl };
+      route.stale = std::chrono::milliseconds{ stale };
+      cache.routes.push_back(std::move(route));
+    }
+  }
+  if (pt.get_child_optional("access.filename")) {
+    access.filename = pt.get<std::filesystem::path>("access.filename");
+    if (access.filename->is_relative()) {
+      access.filename = std::filesystem::absolute(file.parent_path() / *access.filename);
+    }
+  }
+  trace.slow = std::chrono::milliseconds{ pt.get<std::size_t>("trace.slow", trace.slow.count()) };
+  trace.sample = pt.get<std::size_t>("trace.sample", trace.sample);
+  if (pt.get_child_optional("trace.filename")) {
+    trace.filename = pt.get<std::filesystem::path>("trace.filename");
+    if (trace.filename->is_relative()) {
+      trace.filename = std::filesystem::absolute(file.parent_path() / *trace.filename);
+    }
+  }
 }
 
 }  // namespace app
@@ -7,14 +7,116 @@ struct config {
   struct server {
     std::string address;
     std::string service;
+    std::size_t workers = 0;
     bool proxied = false;
+    std::string trusted;
+    std::chrono::milliseconds wait{ 10000 };
+    bool prewarm = false;
+    int backlog = asio::socket_base::max_listen_connections;
+    bool nodelay = false;
+    std::chrono::seconds defer_accept{ 0 };
+    int fastopen = 0;
+    int sndbuf = 0;
+    int rcvbuf = 0;
+    int notsent_lowat = 0;
+    std::chrono::microseconds busy_poll{ 0 };
   } server;
 
+  struct vhost {
+    std::string name;
+    std::vector<std::string> hosts;
+    std::optional<std::filesystem::path> html;
+    std::optional<std::filesystem::path> data;
+    std::string cache;
+    bool proxied = false;
+  };
+  std::vector<vhost> vhosts;
+
+  struct mime {
+    struct type {
+      std::string extension;
+      std::string name;
+      std::optional<bool> compress;
+      std::optional<bool> sendfile;
+      std::optional<std::chrono::seconds> max_age;
+    };
+    std::optional<std::filesystem::path> file;
+    bool precompressed = false;
+    std::uint64_t sendfile = 65536;
+    std::vector<type> types;
+  } mime;
+
+  struct cpu {
+    std::vector<unsigned> server;
+    std::vector<unsigned> logger;
+    std::vector<unsigned> background;
+  } cpu;
+
   struct log {
     std::optional<std::filesystem::path> filename;
     spdlog::level::level_enum severity = spdlog::level::off;
   } log;
 
+  struct upload {
+    std::optional<std::string> directory;
+    std::uint64_t size = 1073741824;
+  } upload;
+
+  struct store {
+    std::optional<std::filesystem::path> filename;
+    std::size_t capacity = 1073741824;
+  } store;
+
+  struct websocket {
+    std::size_t queue = 256;
+    std::size_t bytes = 1048576;
+    bool publish = false;
+  } websocket;
+
+  struct limit {
+    struct route {
+      std::string prefix;
+      double rate = 0.0;
+      double burst = 0.0;
+      double bandwidth = 0.0;
+    };
+    std::size_t size = 65536;
+    std::vector<route> routes;
+  } limit;
+
+  struct upstream {
+    struct route {
+      std::string prefix;
+      std::vector<std::string> backends;
+    };
+    bool least_outstanding = true;
+    std::size_t connections = 16;
+    std::chrono::milliseconds timeout{ 30000 };
+    std::chrono::milliseconds fail_timeout{ 10000 };
+    std::vector<route> routes;
+  } upstream;
+
+  struct cache {
+    struct route {
+      std::string prefix;
+      std::chrono::milliseconds ttl{ 0 };
+      std::chrono::milliseconds stale{ 0 };
+    };
+    std::size_t size = 67108864;
+    std::size_t entry = 1048576;
+    std::vector<route> routes;
+  } cache;
+
+  struct access {
+    std::optional<std::filesystem::path> filename;
+  } access;
+
+  struct trace {
+    std::chrono::milliseconds slow{ 0 };
+    std::size_t sample = 0;
+    std::optional<std::filesystem::path> filename;
+  } trace;
+
   void parse(const std::filesystem::path& file);
 };
 
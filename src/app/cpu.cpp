@@ -0,0 +1,84 @@
+#include "cpu.hpp"
+#include <fmt/ranges.h>
+#include <algorithm>
+#include <charconv>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace app {
+
+std::vector<unsigned> parse_cpus(std::string_view list)
+{
+  const auto number = [&list](std::string_view text) {
+    unsigned value = 0;
+    const auto end = text.data() + text.size();
+    if (text.empty() || std::from_chars(text.data(), end, value).ptr != end) {
+      throw std::runtime_error("Invalid CPU list (" + std::string(list) + ")");
+    }
+    return value;
+  };
+
+  std::vector<unsigned> cpus;
+  for (auto rest = list; !rest.empty();) {
+    auto item = rest.substr(0, rest.find(','));
+    rest.remove_prefix(std::min(item.size() + 1, rest.size()));
+    while (!item.empty() && item.front() == ' ') {
+      item.remove_prefix(1);
+    }
+    while (!item.empty() && item.back() == ' ') {
+      item.remove_suffix(1);
+    }
+    if (item.empty()) {
+      continue;
+    }
+    const auto dash = item.find('-');
+    const auto first = number(item.substr(0, dash));
+    const auto last = dash == std::string_view::npos ? first : number(item.substr(dash + 1));
+    if (last < first) {
+      throw std::runtime_error("Invalid CPU list (" + std::string(list) + ")");
+    }
+    for (auto cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+void pin(const std::vector<unsigned>& cpus, std::string_view name)
+{
+  if (cpus.empty()) {
+    return;
+  }
+#ifdef _WIN32
+  DWORD_PTR mask = 0;
+  for (const auto cpu : cpus) {
+    if (cpu < sizeof(mask) * 8) {
+      mask |= DWORD_PTR{ 1 } << cpu;
+    }
+  }
+  if (!::SetThreadAffinityMask(::GetCurrentThread(), mask)) {
+    LOGW("[:SERVER:] Could not pin {} thread ({})", name, ::GetLastError());
+    return;
+  }
+#else
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (const auto code = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+    LOGW("[:SERVER:] Could not pin {} thread ({})", name, std::generic_category().message(code));
+    return;
+  }
+#endif
+  LOGD("[:SERVER:] Pinned {} thread to CPU {}", name, fmt::join(cpus, ","));
+}
+
+}  // namespace app
@@ -0,0 +1,13 @@
+#pragma once
+#include <common.hpp>
+
+namespace app {
+
+// Parses a CPU list like "0-3,8".
+std::vector<unsigned> parse_cpus(std::string_view list);
+
+// Restricts the calling thread to the given CPUs. Does nothing if the list is empty.
+// Memory that the thread touches first after this call is allocated on the NUMA node of these CPUs.
+void pin(const std::vector<unsigned>& cpus, std::string_view name);
+
+}  // namespace app
@@ -0,0 +1,46 @@
+#include "shared.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace app {
+
+shared::shared(std::size_t size) : size_(size)
+{
+#ifndef _WIN32
+  handle_ = ::memfd_create("server", MFD_CLOEXEC);
+  if (handle_ == -1) {
+    throw std::system_error(errno, std::generic_category(), "Could not create shared memory");
+  }
+  if (::ftruncate(handle_, static_cast<off_t>(size_)) == -1) {
+    const auto code = errno;
+    ::close(handle_);
+    throw std::system_error(code, std::generic_category(), "Could not resize shared memory");
+  }
+  const auto data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, handle_, 0);
+  if (data == MAP_FAILED) {
+    const auto code = errno;
+    ::close(handle_);
+    throw std::system_error(code, std::generic_category(), "Could not map shared memory");
+  }
+  data_ = data;
+#else
+  throw std::runtime_error("Shared memory is not supported on this platform.");
+#endif
+}
+
+shared::~shared()
+{
+#ifndef _WIN32
+  if (data_) {
+    ::munmap(data_, size_);
+  }
+  if (handle_ != -1) {
+    ::close(handle_);
+  }
+#endif
+}
+
+}  // namespace app
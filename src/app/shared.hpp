@@ -0,0 +1,35 @@
+#pragma once
+#include <common.hpp>
+
+namespace app {
+
+// Anonymous shared memory that forked processes inherit.
+// The memory is backed by a memfd and zero-filled.
+class shared {
+public:
+  shared(std::size_t size);
+
+  shared(shared&& other) = delete;
+  shared(const shared& other) = delete;
+  shared& operator=(shared&& other) = delete;
+  shared& operator=(const shared& other) = delete;
+
+  ~shared();
+
+  void* data() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  int handle_ = -1;
+  void* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace app
@@ -0,0 +1,42 @@
+#pragma once
+#include <common.hpp>
+
+namespace app {
+
+// Measures consecutive phases, for example during startup.
+class stopwatch {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // Ends the current phase.
+  void mark(std::string_view name)
+  {
+    const auto now = clock::now();
+    phases_.emplace_back(name, now - last_);
+    last_ = now;
+  }
+
+  // Returns the time since the stopwatch was created.
+  clock::duration total() const noexcept
+  {
+    return clock::now() - start_;
+  }
+
+  // Formats the phases like "config: 0.123 ms, logger: 0.045 ms".
+  std::string report() const
+  {
+    std::string result;
+    for (const auto& [name, duration] : phases_) {
+      const auto ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+      fmt::format_to(std::back_inserter(result), "{}{}: {:.3f} ms", result.empty() ? "" : ", ", name, ms);
+    }
+    return result;
+  }
+
+private:
+  clock::time_point start_ = clock::now();
+  clock::time_point last_ = start_;
+  std::vector<std::pair<std::string_view, clock::duration>> phases_;
+};
+
+}  // namespace app
@@ -0,0 +1,391 @@
+#include "store.hpp"
+#include <app/cpu.hpp>
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace app {
+namespace {
+
+constexpr std::uint32_t tombstone = 0xFFFFFFFF;
+constexpr std::uint64_t compact_threshold = 1048576;
+
+struct header {
+  std::uint32_t checksum = 0;
+  std::uint32_t key = 0;
+  std::uint32_t value = 0;
+};
+
+std::uint32_t checksum(std::string_view key, std::string_view value, std::uint32_t size) noexcept
+{
+  std::uint32_t hash = 0x811C9DC5;
+  const auto update = [&](const char* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; i++) {
+      hash = (hash ^ static_cast<std::uint8_t>(data[i])) * 0x01000193;
+    }
+  };
+  update(reinterpret_cast<const char*>(&size), sizeof(size));
+  update(key.data(), key.size());
+  update(value.data(), value.size());
+  return hash;
+}
+
+void write(int handle, std::string_view data, std::uint64_t offset)
+{
+#ifndef _WIN32
+  for (std::size_t pos = 0; pos < data.size();) {
+    const auto size = ::pwrite(handle, data.data() + pos, data.size() - pos, static_cast<off_t>(offset + pos));
+    if (size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "Could not write to the store");
+    }
+    pos += static_cast<std::size_t>(size);
+  }
+#else
+  throw std::runtime_error("Store is not supported on this platform.");
+#endif
+}
+
+void sync(int handle)
+{
+#ifndef _WIN32
+  if (::fdatasync(handle) == -1) {
+    throw std::system_error(errno, std::generic_category(), "Could not sync the store");
+  }
+#else
+  throw std::runtime_error("Store is not supported on this platform.");
+#endif
+}
+
+void truncate(int handle, std::uint64_t size)
+{
+#ifndef _WIN32
+  if (::ftruncate(handle, static_cast<off_t>(size)) == -1) {
+    throw std::system_error(errno, std::generic_category(), "Could not truncate the store");
+  }
+#else
+  throw std::runtime_error("Store is not supported on this platform.");
+#endif
+}
+
+// Appends a record to the buffer and returns the offset of the value relative to the start of the record.
+std::size_t record(std::string& buffer, std::string_view key, std::optional<std::string_view> value)
+{
+  header header;
+  header.key = static_cast<std::uint32_t>(key.size());
+  header.value = value ? static_cast<std::uint32_t>(value->size()) : tombstone;
+  header.checksum = checksum(key, value.value_or(std::string_view{}), header.value);
+  buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  buffer.append(key);
+  if (value) {
+    buffer.append(*value);
+  }
+  return sizeof(header) + key.size();
+}
+
+}  // namespace
+
+store::segment::segment(const std::filesystem::path& filename, std::size_t capacity) : capacity_(capacity)
+{
+#ifndef _WIN32
+  handle_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (handle_ == -1) {
+    throw std::system_error(errno, std::generic_category(), "Could not open store (" + filename.string() + ")");
+  }
+
+  // Reserve the whole capacity so that values never move while the segment is alive.
+  const auto data = ::mmap(nullptr, capacity_, PROT_READ, MAP_SHARED, handle_, 0);
+  if (data == MAP_FAILED) {
+    const auto code = errno;
+    ::close(handle_);
+    throw std::system_error(code, std::generic_category(), "Could not map store (" + filename.string() + ")");
+  }
+  data_ = static_cast<char*>(data);
+#else
+  throw std::runtime_error("Store is not supported on this platform.");
+#endif
+}
+
+store::segment::~segment()
+{
+#ifndef _WIN32
+  if (data_) {
+    ::munmap(data_, capacity_);
+  }
+  if (handle_ != -1) {
+    ::close(handle_);
+  }
+#endif
+}
+
+store::store(const app::config& config) : filename_(*config.store.filename), capacity_(config.store.capacity)
+{
+  segment_ = std::make_shared<segment>(filename_, capacity_);
+  load();
+  thread_ = std::thread([this, cpus = config.cpu.background]() {
+    app::pin(cpus, "store");
+    run();
+  });
+}
+
+store::~store()
+{
+  {
+    std::lock_guard lock{ sync_mutex_ };
+    stop_ = true;
+  }
+  sync_cv_.notify_one();
+  thread_.join();
+}
+
+std::optional<store::value> store::get(std::string_view key) const
+{
+  std::shared_lock lock{ mutex_ };
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  return value{ segment_, std::string_view{ segment_->data() + it->second.offset, it->second.size } };
+}
+
+auto store::put(std::string_view key, std::string_view value) -> asio::awaitable<void>
+{
+  co_await sync(append(key, value));
+}
+
+auto store::erase(std::string_view key) -> asio::awaitable<bool>
+{
+  {
+    std::shared_lock lock{ mutex_ };
+    if (index_.find(key) == index_.end()) {
+      co_return false;
+    }
+  }
+  co_await sync(append(key, std::nullopt));
+  co_return true;
+}
+
+void store::load()
+{
+  std::error_code ec;
+  const auto file_size = std::filesystem::file_size(filename_, ec);
+  if (ec) {
+    throw std::system_error(ec, "Could not get store size (" + filename_.string() + ")");
+  }
+  if (file_size > capacity_) {
+    throw std::runtime_error("Store is larger than its capacity (" + filename_.string() + ")");
+  }
+
+  const auto offset = replay(index_, garbage_, segment_->data(), 0, file_size, 0);
+  if (offset != file_size) {
+    LOGW("[:STORE:] Discarding {} bytes after the last valid record", file_size - offset);
+    truncate(segment_->handle(), offset);
+  }
+  size_ = offset;
+  synced_ = offset;
+  LOGD("[:STORE:] Loaded {} keys ({} bytes, {} bytes garbage)", index_.size(), size_, garbage_);
+}
+
+std::uint64_t store::replay(table& index, std::uint64_t& garbage, const char* data, std::uint64_t begin,
+  std::uint64_t end, std::uint64_t target)
+{
+  // Read records until the end or the first incomplete or corrupted record.
+  auto offset = begin;
+  while (offset + sizeof(header) <= end) {
+    header header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    const auto value_size = header.value == tombstone ? 0 : header.value;
+    const auto size = sizeof(header) + header.key + std::uint64_t{ value_size };
+    if (offset + size > end) {
+      break;
+    }
+    const auto key = std::string_view{ data + offset + sizeof(header), header.key };
+    const auto value = std::string_view{ key.data() + key.size(), value_size };
+    if (checksum(key, value, header.value) != header.checksum) {
+      break;
+    }
+    const auto location = store::location{ target + offset - begin + sizeof(header) + header.key, header.value };
+    if (const auto it = index.find(key); it != index.end()) {
+      garbage += sizeof(header) + it->first.size() + it->second.size;
+      if (header.value == tombstone) {
+        index.erase(it);
+        garbage += size;
+      } else {
+        it->second = location;
+      }
+    } else if (header.value != tombstone) {
+      index.emplace(key, location);
+    } else {
+      garbage += size;
+    }
+    offset += size;
+  }
+  return offset;
+}
+
+auto store::append(std::string_view key, std::optional<std::string_view> value) -> position
+{
+  if (key.size() >= tombstone || (value && value->size() >= tombstone)) {
+    throw std::length_error("Store key or value is too large");
+  }
+  thread_local std::string buffer;
+  buffer.clear();
+  const auto value_offset = record(buffer, key, value);
+
+  std::unique_lock lock{ mutex_ };
+  if (size_ + buffer.size() > capacity_) {
+    throw std::length_error("Store capacity exceeded");
+  }
+  write(segment_->handle(), buffer, size_);
+  if (const auto it = index_.find(key); it != index_.end()) {
+    garbage_ += sizeof(header) + it->first.size() + it->second.size;
+    if (value) {
+      it->second = { size_ + value_offset, static_cast<std::uint32_t>(value->size()) };
+    } else {
+      index_.erase(it);
+      garbage_ += buffer.size();
+    }
+  } else if (value) {
+    index_.emplace(key, location{ size_ + value_offset, static_cast<std::uint32_t>(value->size()) });
+  } else {
+    garbage_ += buffer.size();
+  }
+  size_ += buffer.size();
+  return { generation_, size_ };
+}
+
+auto store::sync(position position) -> asio::awaitable<void>
+{
+  auto executor = co_await asio::this_coro::executor;
+  asio::steady_timer timer{ executor, asio::steady_timer::time_point::max() };
+  {
+    std::lock_guard lock{ sync_mutex_ };
+    // A record appended before a compaction is part of the first base_ bytes of the new log.
+    const auto offset = position.generation == generation_ ? position.offset : base_;
+    if (synced_ >= offset) {
+      co_return;
+    }
+    waiters_.push_back({ offset, &timer });
+  }
+  sync_cv_.notify_one();
+  boost::system::error_code ec;
+  co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+}
+
+void store::run()
+{
+  // Wakes a waiter on the executor of its timer.
+  const auto wake = [](const waiter& waiter) {
+    asio::post(waiter.timer->get_executor(), [timer = waiter.timer]() {
+      timer->cancel();
+    });
+  };
+
+  std::unique_lock lock{ sync_mutex_ };
+  while (true) {
+    sync_cv_.wait(lock, [this]() {
+      return stop_ || !waiters_.empty();
+    });
+    if (stop_ && waiters_.empty()) {
+      break;
+    }
+    lock.unlock();
+
+    // Sync everything that was written so far with a single call.
+    std::uint64_t size = 0;
+    std::uint64_t generation = 0;
+    std::shared_ptr<const segment> segment;
+    bool compact = false;
+    {
+      std::shared_lock index_lock{ mutex_ };
+      size = size_;
+      generation = generation_;
+      segment = segment_;
+      compact = size_ > compact_threshold && garbage_ > size_ / 2;
+    }
+    try {
+      app::sync(segment->handle());
+      if (compact) {
+        this->compact();
+      }
+    }
+    catch (const std::exception& e) {
+      LOGE("[:STORE:] {}", e.what());
+    }
+
+    // A compaction publishes what it synced of the new log and rebases the waiters itself.
+    lock.lock();
+    if (generation == generation_) {
+      synced_ = std::max(synced_, size);
+    }
+    const auto end = std::partition(waiters_.begin(), waiters_.end(), [this](const waiter& waiter) {
+      return waiter.offset > synced_;
+    });
+    std::for_each(end, waiters_.end(), wake);
+    waiters_.erase(end, waiters_.end());
+  }
+}
+
+void store::compact()
+{
+  auto filename = filename_;
+  filename += ".compact";
+  std::error_code ec;
+  std::filesystem::remove(filename, ec);
+
+  // Copy the live records of a snapshot. Reads and appends continue meanwhile.
+  std::vector<std::pair<std::string, location>> records;
+  std::shared_ptr<const segment> source;
+  std::uint64_t before = 0;
+  {
+    std::shared_lock lock{ mutex_ };
+    records.assign(index_.begin(), index_.end());
+    source = segment_;
+    before = size_;
+  }
+  auto segment = std::make_shared<store::segment>(filename, capacity_);
+  table index;
+  index.reserve(records.size());
+  std::string buffer;
+  std::uint64_t size = 0;
+  for (auto& [key, location] : records) {
+    const auto value = std::string_view{ source->data() + location.offset, location.size };
+    buffer.clear();
+    const auto value_offset = record(buffer, key, value);
+    write(segment->handle(), buffer, size);
+    index.emplace(std::move(key), store::location{ size + value_offset, location.size });
+    size += buffer.size();
+  }
+  app::sync(segment->handle());
+  const auto synced = size;
+
+  // Replay the records appended since the snapshot and replace the log.
+  std::unique_lock lock{ mutex_ };
+  std::uint64_t garbage = 0;
+  write(segment->handle(), std::string_view{ source->data() + before, size_ - before }, size);
+  size = replay(index, garbage, source->data(), before, size_, size) - before + size;
+  std::filesystem::rename(filename, filename_);
+  LOGD("[:STORE:] Compacted {} bytes to {} bytes", size_, size);
+  index_ = std::move(index);
+  segment_ = std::move(segment);
+  size_ = size;
+  garbage_ = garbage;
+
+  // Waiters for records of the old log wait until the whole new log is synced.
+  std::lock_guard sync_lock{ sync_mutex_ };
+  generation_++;
+  base_ = size;
+  synced_ = synced;
+  for (auto& waiter : waiters_) {
+    waiter.offset = size;
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,135 @@
+#pragma once
+#include <app/config.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace app {
+
+// Embedded key-value store.
+// Records are appended to a log file that is memory-mapped for reading. The index maps keys to record
+// locations in the mapping. Writes are made durable in batches by a background thread, which also
+// compacts the log when most of it is garbage. Compaction copies a snapshot of the index while reads and
+// appends continue, and holds the exclusive lock only to replay the appends made meanwhile and swap the logs.
+class store {
+public:
+  // Memory-mapped log file.
+  class segment {
+  public:
+    segment(const std::filesystem::path& filename, std::size_t capacity);
+
+    segment(segment&& other) = delete;
+    segment(const segment& other) = delete;
+    segment& operator=(segment&& other) = delete;
+    segment& operator=(const segment& other) = delete;
+
+    ~segment();
+
+    int handle() const noexcept
+    {
+      return handle_;
+    }
+
+    const char* data() const noexcept
+    {
+      return data_;
+    }
+
+    std::size_t capacity() const noexcept
+    {
+      return capacity_;
+    }
+
+  private:
+    int handle_ = -1;
+    char* data_ = nullptr;
+    std::size_t capacity_ = 0;
+  };
+
+  // Value that references the mapping and keeps it alive.
+  struct value {
+    std::shared_ptr<const store::segment> owner;
+    std::string_view data;
+  };
+
+  store(const app::config& config);
+
+  store(store&& other) = delete;
+  store(const store& other) = delete;
+  store& operator=(store&& other) = delete;
+  store& operator=(const store& other) = delete;
+
+  ~store();
+
+  std::optional<value> get(std::string_view key) const;
+
+  // Stores a value and waits until it is durable.
+  auto put(std::string_view key, std::string_view value) -> asio::awaitable<void>;
+
+  // Removes a value and waits until the removal is durable. Returns false if the key did not exist.
+  auto erase(std::string_view key) -> asio::awaitable<bool>;
+
+private:
+  struct location {
+    std::uint64_t offset = 0;
+    std::uint32_t size = 0;
+  };
+
+  struct hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view key) const noexcept
+    {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  using table = std::unordered_map<std::string, location, hash, std::equal_to<>>;
+
+  // End of an appended record in the log of a generation. Every compaction starts a new generation.
+  struct position {
+    std::uint64_t generation = 0;
+    std::uint64_t offset = 0;
+  };
+
+  // Waiter for an offset in the log of the current generation.
+  struct waiter {
+    std::uint64_t offset = 0;
+    asio::steady_timer* timer = nullptr;
+  };
+
+  void load();
+  std::uint64_t replay(table& index, std::uint64_t& garbage, const char* data, std::uint64_t begin, std::uint64_t end,
+    std::uint64_t target);
+  position append(std::string_view key, std::optional<std::string_view> value);
+  auto sync(position position) -> asio::awaitable<void>;
+  void run();
+  void compact();
+
+  const std::filesystem::path filename_;
+  const std::size_t capacity_;
+
+  // Protects the index, the segment and the log size. Taken before the sync mutex.
+  mutable std::shared_mutex mutex_;
+  table index_;
+  std::shared_ptr<const segment> segment_;
+  std::uint64_t size_ = 0;
+  std::uint64_t garbage_ = 0;
+
+  // Changed under both mutexes when a compaction replaces the log.
+  std::uint64_t generation_ = 0;
+
+  // Protects the group commit state.
+  std::mutex sync_mutex_;
+  std::condition_variable sync_cv_;
+  std::vector<waiter> waiters_;
+  std::uint64_t synced_ = 0;
+
+  // Offset in the current log that covers every record of older generations.
+  std::uint64_t base_ = 0;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace app
@@ -0,0 +1,42 @@
+#include "systemd.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace app {
+
+void notify(std::string_view state) noexcept
+{
+#ifndef _WIN32
+  const auto path = std::getenv("NOTIFY_SOCKET");
+  if (!path || (path[0] != '/' && path[0] != '@')) {
+    return;
+  }
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const auto size = std::strlen(path);
+  if (size >= sizeof(address.sun_path)) {
+    return;
+  }
+  std::memcpy(address.sun_path, path, size);
+  if (address.sun_path[0] == '@') {
+    address.sun_path[0] = '\0';  // abstract namespace
+  }
+  const auto handle = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (handle == -1) {
+    return;
+  }
+  const auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + size);
+  if (::sendto(handle, state.data(), state.size(), MSG_NOSIGNAL, reinterpret_cast<sockaddr*>(&address), length) < 0) {
+    LOGW("[:SERVER:] Could not notify the service manager ({})", std::strerror(errno));
+  }
+  ::close(handle);
+#endif
+}
+
+}  // namespace app
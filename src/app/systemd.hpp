@@ -0,0 +1,9 @@
+#pragma once
+#include <common.hpp>
+
+namespace app {
+
+// Sends a state like "READY=1" to the service manager if NOTIFY_SOCKET is set (see sd_notify(3)).
+void notify(std::string_view state) noexcept;
+
+}  // namespace app
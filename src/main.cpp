@@ -1,4 +1,8 @@
 #include <app/config.hpp>
+#include <app/cpu.hpp>
+#include <app/shared.hpp>
+#include <app/stopwatch.hpp>
+#include <app/systemd.hpp>
 #include <boost/program_options.hpp>
 #include <net/server.hpp>
 #include <spdlog/async.h>
@@ -9,8 +13,19 @@
 #include <spdlog/sinks/sink.h>
 #include <version.h>
 #include <iostream>
+#include <thread>
 #include <cstdlib>
 
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
 #define LOG_PATTERN_DEBUG "[%T.%e] [%^%L%$] %v %@"
 #define LOG_PATTERN_RELEASE "[%Y-%m-%d %T.%e] [%^%L%$] %v"
 
@@ -222,7 +237,6 @@ private:
 
 void logger(spdlog::level::level_enum severity, std::optional<std::filesystem::path> file = {}, std::uint16_t max = 1)
 {
-  spdlog::init_thread_pool(8192, 1);
   spdlog::default_logger()->sinks().clear();
   spdlog::default_logger()->sinks().push_back(std::make_shared<sink>());
   spdlog::set_pattern(LOG_PATTERN, spdlog::pattern_time_type::local);
@@ -243,10 +257,216 @@ void logger(spdlog::level::level_enum severity, std::optional<std::filesystem::p
   spdlog::flush_on(severity);
 }
 
+// Starts the thread of asynchronous loggers. Forked processes must start their own.
+void thread_pool(std::vector<unsigned> cpus)
+{
+  spdlog::init_thread_pool(8192, 1, [cpus = std::move(cpus)]() {
+    app::pin(cpus, "logger");
+  });
+}
+
+// Runs the server until SIGINT or SIGTERM is received.
+int run(app::config config, const std::filesystem::path& html, const std::filesystem::path& data, net::stats& stats,
+  std::size_t worker = 0, int listener = -1)
+{
+  try {
+    thread_pool(config.cpu.logger);
+
+    // Pin the thread before the server allocates its buffers and caches.
+    app::pin(config.cpu.server, "server");
+    asio::io_context context{ 1 };
+    asio::signal_set signals(context, SIGINT, SIGTERM);
+    signals.async_wait([&](auto, auto) {
+      if (listener == -1) {
+        app::notify("STOPPING=1");
+      }
+      context.stop();
+    });
+    const auto busy_poll = config.server.busy_poll;
+    asio::co_spawn(context.get_executor(), net::server{ std::move(config), html, data, stats, worker, listener },
+      asio::detached);
+    if (busy_poll.count() > 0) {
+      // Spin on ready handlers before blocking in the reactor to avoid the wake-up latency.
+      while (!context.stopped()) {
+        const auto deadline = std::chrono::steady_clock::now() + busy_poll;
+        std::size_t count = 0;
+        while ((count = context.poll()) == 0 && !context.stopped() && std::chrono::steady_clock::now() < deadline) {
+        }
+        if (count == 0 && !context.stopped()) {
+          context.run_one();
+        }
+      }
+    } else {
+      context.run();
+    }
+  }
+  catch (const boost::system::system_error& e) {
+    LOGC("{}: {} ({})", e.code().category().name(), e.what(), e.code().value());
+    return e.code().value();
+  }
+  catch (const std::system_error& e) {
+    LOGC("{}: {} ({})", e.code().category().name(), e.what(), e.code().value());
+    return e.code().value();
+  }
+  catch (const std::exception& e) {
+    LOGC("{}", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+#ifndef _WIN32
+
+// Returns "<stem>-<worker><extension>" for files that are written by every worker.
+std::filesystem::path worker_filename(const std::filesystem::path& filename, std::size_t worker)
+{
+  const auto name = fmt::format("{}-{}{}", filename.stem().string(), worker, filename.extension().string());
+  return filename.parent_path() / name;
+}
+
+// Runs a worker process that accepts connections on the listener socket of the master process.
+int worker(app::config config, const std::filesystem::path& html, const std::filesystem::path& data,
+  net::stats& stats, std::size_t worker, int listener)
+{
+#ifdef __linux__
+  ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+  if (config.access.filename) {
+    config.access.filename = worker_filename(*config.access.filename, worker);
+  }
+  if (config.trace.filename) {
+    config.trace.filename = worker_filename(*config.trace.filename, worker);
+  }
+  if (!config.cpu.server.empty()) {
+    config.cpu.server = { config.cpu.server[worker % config.cpu.server.size()] };
+  }
+  config.server.prewarm = false;
+  return run(std::move(config), html, data, stats, worker, listener);
+}
+
+// Forks the workers, restarts workers that exit and stops them on SIGINT or SIGTERM.
+// The workers share the listener socket, the page cache and the counters in a shared memory segment.
+int master(app::config config, const std::filesystem::path& html, const std::filesystem::path& data)
+{
+  using clock = std::chrono::steady_clock;
+  try {
+    const auto workers = config.server.workers;
+    if (workers > net::stats::slot_count) {
+      throw std::runtime_error(fmt::format("Too many workers (maximum {})", net::stats::slot_count));
+    }
+
+    // Read the files into the page cache once for all workers.
+    if (config.server.prewarm) {
+      net::server::prewarm(net::hosts{ config, html, data });
+    }
+
+    // Bind the listener socket without keeping an event loop across fork().
+    int listener = -1;
+    {
+      asio::io_context context{ 1 };
+      listener = net::server::listen(config, context.get_executor()).release();
+    }
+    app::shared memory{ sizeof(net::stats) };
+    auto& stats = *new (memory.data()) net::stats{};
+
+    // Receive signals with sigwait() only. Workers unblock them for their own signal handling.
+    sigset_t signals;
+    ::sigemptyset(&signals);
+    ::sigaddset(&signals, SIGINT);
+    ::sigaddset(&signals, SIGTERM);
+    ::sigaddset(&signals, SIGCHLD);
+    ::sigprocmask(SIG_BLOCK, &signals, nullptr);
+
+    std::vector<pid_t> pids(workers, -1);
+    std::vector<clock::time_point> started(workers);
+    const auto spawn = [&](std::size_t index) {
+      const auto pid = ::fork();
+      if (pid == -1) {
+        throw std::system_error(errno, std::generic_category(), "Could not fork worker");
+      }
+      if (pid == 0) {
+        ::sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+        std::exit(worker(config, html, data, stats, index, listener));
+      }
+      pids[index] = pid;
+      started[index] = clock::now();
+      LOGD("[:MASTER:] Worker {} started (pid {})", index, pid);
+    };
+    for (std::size_t i = 0; i < workers; i++) {
+      spawn(i);
+    }
+    LOGI("[:MASTER:] Version: {} ({} workers)", PROJECT_VERSION, workers);
+    app::notify("READY=1");
+
+    bool stopping = false;
+    std::size_t running = workers;
+    while (running > 0) {
+      int signal = 0;
+      if (::sigwait(&signals, &signal) != 0) {
+        continue;
+      }
+      if (signal != SIGCHLD) {
+        if (!stopping) {
+          stopping = true;
+          app::notify("STOPPING=1");
+          for (const auto pid : pids) {
+            if (pid != -1) {
+              ::kill(pid, SIGTERM);
+            }
+          }
+        }
+        continue;
+      }
+      int status = 0;
+      for (pid_t pid = 0; (pid = ::waitpid(-1, &status, WNOHANG)) > 0;) {
+        const auto it = std::find(pids.begin(), pids.end(), pid);
+        if (it == pids.end()) {
+          continue;
+        }
+        const auto index = static_cast<std::size_t>(it - pids.begin());
+        *it = -1;
+        running--;
+        if (stopping) {
+          continue;
+        }
+        if (WIFSIGNALED(status)) {
+          LOGE("[:MASTER:] Worker {} (pid {}) was killed by signal {}", index, pid, WTERMSIG(status));
+        } else {
+          LOGE("[:MASTER:] Worker {} (pid {}) exited with status {}", index, pid, WEXITSTATUS(status));
+        }
+
+        // Do not restart a worker that fails during startup in a tight loop.
+        if (clock::now() - started[index] < std::chrono::seconds{ 1 }) {
+          std::this_thread::sleep_for(std::chrono::seconds{ 1 });
+        }
+        stats.restart();
+        spawn(index);
+        running++;
+      }
+    }
+  }
+  catch (const boost::system::system_error& e) {
+    LOGC("[:MASTER:] {}: {} ({})", e.code().category().name(), e.what(), e.code().value());
+    return e.code().value();
+  }
+  catch (const std::system_error& e) {
+    LOGC("[:MASTER:] {}: {} ({})", e.code().category().name(), e.what(), e.code().value());
+    return e.code().value();
+  }
+  catch (const std::exception& e) {
+    LOGC("[:MASTER:] {}", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+#endif
+
 }  // namespace
 
 int main(int argc, char* argv[])
 {
+  app::stopwatch startup;
   app::config config;
   std::filesystem::path data;
   std::filesystem::path html;
@@ -299,8 +519,12 @@ int main(int argc, char* argv[])
     data = path / "data";
 #endif
 
+    startup.mark("options");
     config.parse(file);
+    startup.mark("config");
     logger(config.log.severity, config.log.filename, 0);
+    startup.mark("logger");
+    LOGD("[:SERVER:] Startup: {}", startup.report());
   }
   catch (const std::system_error& e) {
     fmt::print(stderr, "{}: {} ({})\n", e.code().category().name(), e.what(), e.code().value());
@@ -310,26 +534,13 @@ int main(int argc, char* argv[])
     fmt::print(stderr, "error: {}\n", e.what());
     return EXIT_FAILURE;
   }
-  try {
-    asio::io_context context{ 1 };
-    asio::signal_set signals(context, SIGINT, SIGTERM);
-    signals.async_wait([&](auto, auto) {
-      context.stop();
-    });
-    asio::co_spawn(context.get_executor(), net::server{ std::move(config), html, data }, asio::detached);
-    context.run();
-  }
-  catch (const boost::system::system_error& e) {
-    LOGC("{}: {} ({})", e.code().category().name(), e.what(), e.code().value());
-    return e.code().value();
-  }
-  catch (const std::system_error& e) {
-    LOGC("{}: {} ({})", e.code().category().name(), e.what(), e.code().value());
-    return e.code().value();
-  }
-  catch (const std::exception& e) {
-    LOGC("{}", e.what());
-    return EXIT_FAILURE;
+  if (config.server.workers > 0) {
+#ifndef _WIN32
+    return master(std::move(config), html, data);
+#else
+    LOGW("[:SERVER:] Workers are not supported on this platform");
+#endif
   }
-  return EXIT_SUCCESS;
+  net::stats stats;
+  return run(std::move(config), html, data, stats);
 }
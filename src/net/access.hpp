@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace net::access {
+
+// Binary access log format.
+// A file is a sequence of blocks. Each block starts with a header, followed by one column per field and by the
+// names of the targets used in this block. Every column and the name table are padded to 8 bytes.
+// Target ids are assigned per block, starting at 0, so that several processes can append to the same file.
+
+constexpr std::uint32_t magic = 0x31474F4C;  // "LOG1"
+constexpr std::uint32_t records = 4096;      // maximum number of records per block
+constexpr std::uint32_t targets = 65536;     // maximum number of target names per block
+constexpr std::uint32_t overflow = targets;  // target id for targets after the limit
+
+struct header {
+  std::uint32_t magic = access::magic;
+  std::uint32_t count = 0;  // number of records
+  std::uint32_t names = 0;  // number of target names
+  std::uint32_t size = 0;   // block size in bytes, including the header
+};
+
+// Target name entry, followed by the name and padded to 8 bytes.
+struct name {
+  std::uint32_t id = 0;
+  std::uint32_t size = 0;
+};
+
+// Columns in file order and their element sizes.
+enum class column : std::size_t {
+  time,     // std::int64_t, microseconds since the unix epoch
+  hi,       // std::uint64_t, client address (see net::client)
+  lo,       // std::uint64_t
+  bytes,    // std::uint64_t, response bytes written
+  latency,  // std::uint32_t, microseconds from the first byte of the request until the response was written
+  target,   // std::uint32_t, target id
+  status,   // std::uint16_t, response status
+  method,   // std::uint8_t, http::verb
+  count,
+};
+
+constexpr std::array<std::size_t, static_cast<std::size_t>(column::count)> column_sizes{ 8, 8, 8, 8, 4, 4, 2, 1 };
+
+constexpr std::size_t align(std::size_t size) noexcept
+{
+  return (size + 7) & ~std::size_t{ 7 };
+}
+
+// Returns the offset of a column relative to the end of the header.
+constexpr std::size_t offset(column column, std::size_t count) noexcept
+{
+  std::size_t result = 0;
+  for (std::size_t i = 0; i < static_cast<std::size_t>(column); i++) {
+    result += align(column_sizes[i] * count);
+  }
+  return result;
+}
+
+}  // namespace net::access
@@ -0,0 +1,301 @@
+#include "cache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace net {
+namespace {
+
+// Returns the directive names of a comma-separated field value.
+std::vector<std::string_view> tokens(std::string_view value)
+{
+  std::vector<std::string_view> result;
+  while (!value.empty()) {
+    const auto pos = value.find(',');
+    auto token = value.substr(0, pos);
+    token = token.substr(0, token.find('='));
+    while (!token.empty() && (token.front() == ' ' || token.front() == '\t')) {
+      token.remove_prefix(1);
+    }
+    while (!token.empty() && (token.back() == ' ' || token.back() == '\t')) {
+      token.remove_suffix(1);
+    }
+    if (!token.empty()) {
+      result.push_back(token);
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(pos + 1);
+  }
+  return result;
+}
+
+// Returns true if a request carries credentials that may personalize the response.
+bool credentials(const http::fields& fields)
+{
+  return fields.count(http::field::authorization) || fields.count(http::field::cookie);
+}
+
+// Returns true if the response may be shared with other users although the request carried credentials.
+bool shared(const http::response<http::string_body>& message)
+{
+  for (const auto token : tokens(message[http::field::cache_control])) {
+    if (beast::iequals(token, "public") || beast::iequals(token, "s-maxage")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool cacheable(const http::response<http::string_body>& message, const http::fields& fields)
+{
+  if (credentials(fields) && !shared(message)) {
+    return false;
+  }
+  switch (message.result()) {
+  case http::status::ok:
+  case http::status::moved_permanently:
+  case http::status::not_found:
+    break;
+  default:
+    return false;
+  }
+  if (message.count(http::field::set_cookie)) {
+    return false;
+  }
+  for (const auto token : tokens(message[http::field::cache_control])) {
+    if (beast::iequals(token, "no-store") || beast::iequals(token, "no-cache") || beast::iequals(token, "private")) {
+      return false;
+    }
+  }
+  for (const auto token : tokens(message[http::field::vary])) {
+    if (token == "*") {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t size(const std::string& key, const cache::value& value) noexcept
+{
+  return key.size() + value.serialized.size() + value.message->body().size();
+}
+
+}  // namespace
+
+cache::cache(const app::config& config, executor_type executor) :
+  executor_(executor), routes_(config.cache.routes), budget_(config.cache.size), limit_(config.cache.entry)
+{
+  // Prefer longer prefixes.
+  std::sort(routes_.begin(), routes_.end(), [](const route& lhs, const route& rhs) {
+    return lhs.prefix.size() > rhs.prefix.size();
+  });
+  for (const auto& route : routes_) {
+    LOGD("[:CACHE:] {} for {} ms, stale for {} ms", route.prefix, route.ttl.count(), route.stale.count());
+  }
+}
+
+auto cache::match(std::string_view target) const noexcept -> const route*
+{
+  for (const auto& route : routes_) {
+    if (target.starts_with(route.prefix)) {
+      return &route;
+    }
+  }
+  return nullptr;
+}
+
+auto cache::get(const http::request<http::string_body>& request, const route& route, producer produce)
+  -> asio::awaitable<std::shared_ptr<const value>>
+{
+  static const std::vector<std::string> none;
+  const auto base = normalize(request);
+  const auto personal = credentials(request.base());
+  bool waited = false;
+  while (true) {
+    const auto vary = vary_.find(base);
+    auto key = this->key(request.base(), base, vary == vary_.end() ? none : vary->second.names);
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+      auto& entry = it->second;
+      const auto now = clock::now();
+      if (entry.data && now < entry.stale && (!personal || shared(*entry.data->message))) {
+        // Revalidate a stale response in the background.
+        if (now >= entry.fresh && !entry.flight) {
+          entry.flight = std::make_shared<asio::steady_timer>(executor_, asio::steady_timer::time_point::max());
+          asio::co_spawn(executor_, fill(base, key, request.base(), route, std::move(produce), entry.flight),
+            asio::detached);
+        }
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+        co_return entry.data;
+      }
+      if (entry.flight && !personal) {
+        const auto flight = entry.flight;
+        boost::system::error_code ec;
+        co_await flight->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        waited = true;
+        continue;
+      }
+    }
+
+    // Requests that waited for a failed or uncacheable response do not wait again.
+    // Requests with credentials bypass the cache unless the response is explicitly shared.
+    std::shared_ptr<asio::steady_timer> flight;
+    if (!waited && !personal) {
+      flight = std::make_shared<asio::steady_timer>(executor_, asio::steady_timer::time_point::max());
+      entries_[key].flight = flight;
+    }
+    // GCC destroys temporaries in co_await expressions twice.
+    auto result = fill(base, std::move(key), request.base(), route, std::move(produce), std::move(flight));
+    co_return co_await std::move(result);
+  }
+}
+
+std::string cache::normalize(const http::request<http::string_body>& request)
+{
+  // The backend receives both host fields, and hosts that fall back to the default virtual host differ.
+  std::string result;
+  for (const auto value : { request[http::field::host], request["X-Forwarded-Host"] }) {
+    std::transform(value.begin(), value.end(), std::back_inserter(result), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    result.push_back(' ');
+  }
+  const auto target = request.target();
+  const auto pos = target.find('?');
+  result.append(request.method_string());
+  result.push_back(' ');
+  result.append(target.substr(0, pos));
+  if (pos == std::string_view::npos) {
+    return result;
+  }
+
+  // Sort query parameters so that their order does not create separate entries.
+  std::vector<std::string_view> parameters;
+  auto query = target.substr(pos + 1);
+  while (!query.empty()) {
+    const auto end = query.find('&');
+    if (const auto parameter = query.substr(0, end); !parameter.empty()) {
+      parameters.push_back(parameter);
+    }
+    if (end == std::string_view::npos) {
+      break;
+    }
+    query.remove_prefix(end + 1);
+  }
+  std::sort(parameters.begin(), parameters.end());
+  auto separator = '?';
+  for (const auto parameter : parameters) {
+    result.push_back(separator);
+    result.append(parameter);
+    separator = '&';
+  }
+  return result;
+}
+
+std::string cache::key(const http::fields& fields, const std::string& base, const std::vector<std::string>& vary)
+{
+  auto result = base;
+  for (const auto& name : vary) {
+    result.push_back('\n');
+    result.append(name);
+    result.push_back(':');
+    result.append(fields[name]);
+  }
+  return result;
+}
+
+auto cache::fill(std::string base, std::string key, http::fields fields, route route, producer produce,
+  std::shared_ptr<asio::steady_timer> flight) -> asio::awaitable<std::shared_ptr<const value>>
+{
+  std::shared_ptr<const response> message;
+  try {
+    message = co_await produce();
+  }
+  catch (const std::exception& e) {
+    LOGE("[:CACHE:] {}", e.what());
+  }
+
+  const auto it = entries_.find(key);
+  if (flight) {
+    if (it != entries_.end() && it->second.flight == flight) {
+      it->second.flight.reset();
+    }
+    flight->cancel();
+  }
+  if (!message) {
+    if (it != entries_.end() && !it->second.data && !it->second.flight) {
+      entries_.erase(it);
+    }
+    co_return nullptr;
+  }
+
+  std::ostringstream os;
+  os << *message;
+  auto result = std::make_shared<const value>(value{ message, os.str() });
+  if (!cacheable(*message, fields) || size(key, *result) > limit_) {
+    if (it != entries_.end() && !it->second.flight && !credentials(fields)) {
+      erase(it);
+    }
+    co_return result;
+  }
+
+  // Store the response under the key for the fields named in its Vary field.
+  std::vector<std::string> vary;
+  for (const auto token : tokens((*message)[http::field::vary])) {
+    vary.emplace_back(token);
+  }
+  auto stored = this->key(fields, base, vary);
+  if (stored != key && it != entries_.end() && !it->second.data && !it->second.flight) {
+    entries_.erase(it);
+  }
+  vary_[std::move(base)].names = std::move(vary);
+  store(stored, result, route);
+  co_return result;
+}
+
+void cache::store(const std::string& key, std::shared_ptr<const value> value, const route& route)
+{
+  const auto now = clock::now();
+  auto& entry = entries_[key];
+  if (entry.data) {
+    size_ -= size(key, *entry.data);
+  } else {
+    vary_[key.substr(0, key.find('\n'))].entries++;
+  }
+  entry.data = std::move(value);
+  entry.fresh = now + route.ttl;
+  entry.stale = entry.fresh + route.stale;
+  size_ += size(key, *entry.data);
+  if (entry.linked) {
+    lru_.splice(lru_.begin(), lru_, entry.lru);
+  } else {
+    entry.lru = lru_.insert(lru_.begin(), key);
+    entry.linked = true;
+  }
+
+  // Evict the least recently used responses.
+  while (size_ > budget_ && !lru_.empty()) {
+    erase(entries_.find(lru_.back()));
+  }
+}
+
+void cache::erase(std::unordered_map<std::string, entry>::iterator it)
+{
+  auto& entry = it->second;
+  if (entry.data) {
+    size_ -= size(it->first, *entry.data);
+
+    // Forget the Vary field names with the last stored response for the normalized target.
+    const auto vary = vary_.find(it->first.substr(0, it->first.find('\n')));
+    if (vary != vary_.end() && --vary->second.entries == 0) {
+      vary_.erase(vary);
+    }
+  }
+  if (entry.linked) {
+    lru_.erase(entry.lru);
+  }
+  entries_.erase(it);
+}
+
+}  // namespace net
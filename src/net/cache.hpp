@@ -0,0 +1,84 @@
+#pragma once
+#include <app/config.hpp>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+namespace net {
+
+// Micro-cache for upstream responses.
+// Responses are cached for a short time per route and may be served stale while a single background request
+// revalidates them. Concurrent misses for the same key wait for one request and share its result. Keys consist
+// of the Host and X-Forwarded-Host fields that the backend receives, the method, the normalized target and the
+// request fields named in the Vary field of the last response. Responses to requests with an Authorization or
+// Cookie field are only shared when they are explicitly public.
+// Must only be used from the server executor.
+class cache {
+public:
+  using executor_type = asio::steady_timer::executor_type;
+  using clock = std::chrono::steady_clock;
+  using route = app::config::cache::route;
+  using response = http::response<http::string_body>;
+  using producer = std::function<asio::awaitable<std::shared_ptr<const response>>()>;
+
+  // Response and its serialized form for HTTP/1.1 keep-alive connections.
+  struct value {
+    std::shared_ptr<const response> message;
+    std::string serialized;
+  };
+
+  cache(const app::config& config, executor_type executor);
+
+  cache(cache&& other) = delete;
+  cache(const cache& other) = delete;
+  cache& operator=(cache&& other) = delete;
+  cache& operator=(const cache& other) = delete;
+
+  // Returns the route with the longest matching prefix.
+  const route* match(std::string_view target) const noexcept;
+
+  // Returns a fresh or stale response or produces one. Returns nullptr if the producer failed.
+  auto get(const http::request<http::string_body>& request, const route& route, producer produce)
+    -> asio::awaitable<std::shared_ptr<const value>>;
+
+private:
+  struct entry {
+    std::shared_ptr<const value> data;
+    clock::time_point fresh;
+    clock::time_point stale;
+    std::shared_ptr<asio::steady_timer> flight;
+    std::list<std::string>::iterator lru;
+    bool linked = false;
+  };
+
+  // Request fields named in the Vary field of the last response and the number of stored responses for a
+  // normalized target.
+  struct variants {
+    std::vector<std::string> names;
+    std::size_t entries = 0;
+  };
+
+  // Returns the lowercase host fields, the method and the target with sorted query parameters.
+  static std::string normalize(const http::request<http::string_body>& request);
+
+  // Returns the key for the values of the named request fields.
+  static std::string key(const http::fields& fields, const std::string& base, const std::vector<std::string>& vary);
+
+  // Runs the producer, stores a cacheable response and wakes the waiters.
+  auto fill(std::string base, std::string key, http::fields fields, route route, producer produce,
+    std::shared_ptr<asio::steady_timer> flight) -> asio::awaitable<std::shared_ptr<const value>>;
+
+  void store(const std::string& key, std::shared_ptr<const value> value, const route& route);
+  void erase(std::unordered_map<std::string, entry>::iterator it);
+
+  executor_type executor_;
+  std::vector<route> routes_;
+  std::size_t budget_ = 0;
+  std::size_t limit_ = 0;
+  std::size_t size_ = 0;
+  std::unordered_map<std::string, entry> entries_;
+  std::unordered_map<std::string, variants> vary_;
+  std::list<std::string> lru_;
+};
+
+}  // namespace net
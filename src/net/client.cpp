@@ -0,0 +1,295 @@
+#include "client.hpp"
+#include <array>
+
+namespace net {
+namespace {
+
+constexpr std::uint64_t mapped = 0x0000FFFF00000000ULL;
+
+constexpr bool is_space(char c) noexcept
+{
+  return c == ' ' || c == '\t';
+}
+
+constexpr std::string_view trim(std::string_view text) noexcept
+{
+  while (!text.empty() && is_space(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && is_space(text.back())) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+constexpr int hex(char c) noexcept
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+std::optional<std::uint32_t> parse_v4(std::string_view text) noexcept
+{
+  std::uint32_t address = 0;
+  std::size_t octets = 0;
+  while (octets < 4) {
+    std::uint32_t octet = 0;
+    std::size_t digits = 0;
+    while (!text.empty() && text.front() >= '0' && text.front() <= '9' && digits < 3) {
+      octet = octet * 10 + static_cast<std::uint32_t>(text.front() - '0');
+      text.remove_prefix(1);
+      digits++;
+    }
+    if (!digits || octet > 255) {
+      return std::nullopt;
+    }
+    address = address << 8 | octet;
+    if (++octets < 4) {
+      if (text.empty() || text.front() != '.') {
+        return std::nullopt;
+      }
+      text.remove_prefix(1);
+    }
+  }
+  if (!text.empty()) {
+    return std::nullopt;
+  }
+  return address;
+}
+
+std::optional<std::array<std::uint16_t, 8>> parse_v6(std::string_view text) noexcept
+{
+  std::array<std::uint16_t, 8> head{};
+  std::array<std::uint16_t, 8> tail{};
+  std::size_t head_size = 0;
+  std::size_t tail_size = 0;
+  bool compressed = false;
+  if (text.starts_with("::")) {
+    compressed = true;
+    text.remove_prefix(2);
+  }
+  while (!text.empty()) {
+    auto& groups = compressed ? tail : head;
+    auto& size = compressed ? tail_size : head_size;
+    if (head_size + tail_size >= 8) {
+      return std::nullopt;
+    }
+
+    // Embedded IPv4 address.
+    if (const auto end = text.find(':'); end == std::string_view::npos && text.find('.') != std::string_view::npos) {
+      const auto v4 = parse_v4(text);
+      if (!v4 || head_size + tail_size > 6) {
+        return std::nullopt;
+      }
+      groups[size++] = static_cast<std::uint16_t>(*v4 >> 16);
+      groups[size++] = static_cast<std::uint16_t>(*v4 & 0xFFFF);
+      text = {};
+      break;
+    }
+
+    std::uint32_t group = 0;
+    std::size_t digits = 0;
+    while (!text.empty() && digits < 4) {
+      const auto value = hex(text.front());
+      if (value < 0) {
+        break;
+      }
+      group = group << 4 | static_cast<std::uint32_t>(value);
+      text.remove_prefix(1);
+      digits++;
+    }
+    if (!digits) {
+      return std::nullopt;
+    }
+    groups[size++] = static_cast<std::uint16_t>(group);
+    if (text.empty()) {
+      break;
+    }
+    if (text.front() != ':') {
+      return std::nullopt;
+    }
+    text.remove_prefix(1);
+    if (!text.empty() && text.front() == ':') {
+      if (compressed) {
+        return std::nullopt;
+      }
+      compressed = true;
+      text.remove_prefix(1);
+    } else if (text.empty()) {
+      return std::nullopt;
+    }
+  }
+  if (compressed ? head_size + tail_size > 7 : head_size != 8) {
+    return std::nullopt;
+  }
+  std::array<std::uint16_t, 8> groups{};
+  for (std::size_t i = 0; i < head_size; i++) {
+    groups[i] = head[i];
+  }
+  for (std::size_t i = 0; i < tail_size; i++) {
+    groups[8 - tail_size + i] = tail[i];
+  }
+  return groups;
+}
+
+}  // namespace
+
+client::client(const asio::ip::address& address) noexcept
+{
+  if (address.is_v4()) {
+    *this = client{ 0, mapped | address.to_v4().to_ulong(), version::v4 };
+  } else if (address.is_v6()) {
+    const auto bytes = address.to_v6().to_bytes();
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+    for (std::size_t i = 0; i < 8; i++) {
+      hi = hi << 8 | bytes[i];
+      lo = lo << 8 | bytes[i + 8];
+    }
+    *this = client{ hi, lo, !hi && (lo >> 32) == 0xFFFF ? version::v4 : version::v6 };
+  }
+}
+
+std::optional<client> client::parse(std::string_view text) noexcept
+{
+  text = trim(text);
+  if (text.size() > 2 && text.front() == '[') {
+    if (const auto end = text.find(']'); end != std::string_view::npos) {
+      text = text.substr(1, end - 1);
+    }
+  }
+  if (const auto pos = text.find(':'); pos == std::string_view::npos || text.find(':', pos + 1) == std::string_view::npos) {
+    // IPv4 address with an optional port.
+    if (const auto v4 = parse_v4(text.substr(0, pos))) {
+      return client{ 0, mapped | *v4, version::v4 };
+    }
+    return std::nullopt;
+  }
+  if (const auto v6 = parse_v6(text)) {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+    for (std::size_t i = 0; i < 4; i++) {
+      hi = hi << 16 | (*v6)[i];
+      lo = lo << 16 | (*v6)[i + 4];
+    }
+    return client{ hi, lo, !hi && (lo >> 32) == 0xFFFF ? version::v4 : version::v6 };
+  }
+  return std::nullopt;
+}
+
+asio::ip::address client::address() const noexcept
+{
+  switch (version_) {
+  case version::v4:
+    return asio::ip::address_v4{ static_cast<asio::ip::address_v4::uint_type>(lo_ & 0xFFFFFFFF) };
+  case version::v6: {
+    asio::ip::address_v6::bytes_type bytes;
+    for (std::size_t i = 0; i < 8; i++) {
+      bytes[i] = static_cast<unsigned char>(hi_ >> (56 - i * 8));
+      bytes[i + 8] = static_cast<unsigned char>(lo_ >> (56 - i * 8));
+    }
+    return asio::ip::address_v6{ bytes };
+  }
+  default:
+    return {};
+  }
+}
+
+std::size_t client::format(char* buffer) const noexcept
+{
+  constexpr std::string_view digits = "0123456789ABCDEF";
+  const auto write = [&](std::uint64_t value, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      buffer[count - i - 1] = digits[value & 0xF];
+      value >>= 4;
+    }
+    buffer += count;
+  };
+  switch (version_) {
+  case version::v4:
+    write(lo_ & 0xFFFFFFFF, 8);
+    return 8;
+  case version::v6:
+    write(hi_, 16);
+    write(lo_, 16);
+    return 32;
+  default:
+    break;
+  }
+  constexpr std::string_view unknown = "CLIENT";
+  std::copy(unknown.begin(), unknown.end(), buffer);
+  return unknown.size();
+}
+
+networks::networks(std::string_view list)
+{
+  while (!list.empty()) {
+    const auto end = list.find_first_of(", \t");
+    const auto item = list.substr(0, end);
+    list = end == std::string_view::npos ? std::string_view{} : list.substr(end + 1);
+    if (item.empty()) {
+      continue;
+    }
+    const auto slash = item.find('/');
+    const auto address = client::parse(item.substr(0, slash));
+    if (!address) {
+      throw std::runtime_error("Invalid network address (" + std::string(item) + ")");
+    }
+    std::size_t bits = address->is_v4() ? 32 : 128;
+    if (slash != std::string_view::npos) {
+      const auto text = item.substr(slash + 1);
+      std::size_t prefix = 0;
+      if (text.empty() || text.size() > 3 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+        throw std::runtime_error("Invalid network prefix (" + std::string(item) + ")");
+      }
+      for (const auto c : text) {
+        prefix = prefix * 10 + static_cast<std::size_t>(c - '0');
+      }
+      if (prefix > bits) {
+        throw std::runtime_error("Invalid network prefix (" + std::string(item) + ")");
+      }
+      bits = prefix;
+    }
+    if (address->is_v4()) {
+      bits += 96;
+    }
+    entry e;
+    e.mask_hi = bits >= 64 ? ~0ULL : bits ? ~0ULL << (64 - bits) : 0;
+    e.mask_lo = bits >= 128 ? ~0ULL : bits > 64 ? ~0ULL << (128 - bits) : 0;
+    e.hi = address->hi() & e.mask_hi;
+    e.lo = address->lo() & e.mask_lo;
+    entries_.push_back(e);
+  }
+}
+
+client forwarded(std::string_view chain, const client& peer, const networks& trusted) noexcept
+{
+  auto result = peer;
+  if (!trusted.empty() && !trusted.contains(peer)) {
+    return result;
+  }
+  while (!chain.empty()) {
+    const auto pos = chain.rfind(',');
+    const auto item = pos == std::string_view::npos ? chain : chain.substr(pos + 1);
+    chain = pos == std::string_view::npos ? std::string_view{} : chain.substr(0, pos);
+    const auto address = client::parse(item);
+    if (!address) {
+      break;
+    }
+    result = *address;
+    if (trusted.empty() || !trusted.contains(result)) {
+      break;
+    }
+  }
+  return result;
+}
+
+}  // namespace net
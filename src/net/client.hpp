@@ -0,0 +1,118 @@
+#pragma once
+#include <common.hpp>
+
+namespace net {
+
+// Client address in binary form. IPv4 addresses are stored as IPv4-mapped IPv6 addresses.
+class client {
+public:
+  constexpr client() noexcept = default;
+
+  explicit client(const asio::ip::address& address) noexcept;
+
+  // Parses an IPv4 or IPv6 address without allocating.
+  static std::optional<client> parse(std::string_view text) noexcept;
+
+  constexpr bool is_v4() const noexcept
+  {
+    return version_ == version::v4;
+  }
+
+  constexpr bool is_v6() const noexcept
+  {
+    return version_ == version::v6;
+  }
+
+  constexpr std::uint64_t hi() const noexcept
+  {
+    return hi_;
+  }
+
+  constexpr std::uint64_t lo() const noexcept
+  {
+    return lo_;
+  }
+
+  constexpr explicit operator bool() const noexcept
+  {
+    return version_ != version::none;
+  }
+
+  friend constexpr bool operator==(const client& lhs, const client& rhs) noexcept
+  {
+    return lhs.hi_ == rhs.hi_ && lhs.lo_ == rhs.lo_ && lhs.version_ == rhs.version_;
+  }
+
+  // Converts the address back to its asio representation.
+  asio::ip::address address() const noexcept;
+
+  // Formats the address as 8 (IPv4) or 32 (IPv6) hex digits.
+  // Returns the number of characters written to the buffer.
+  std::size_t format(char* buffer) const noexcept;
+
+private:
+  enum class version : std::uint8_t {
+    none,
+    v4,
+    v6,
+  };
+
+  constexpr client(std::uint64_t hi, std::uint64_t lo, net::client::version version) noexcept :
+    hi_(hi), lo_(lo), version_(version)
+  {}
+
+  std::uint64_t hi_ = 0;
+  std::uint64_t lo_ = 0;
+  net::client::version version_ = version::none;
+};
+
+// Precompiled table of networks in CIDR notation.
+class networks {
+public:
+  networks() = default;
+
+  // Parses a comma or space separated list like "127.0.0.1/8, ::1, 10.0.0.0/8".
+  explicit networks(std::string_view list);
+
+  bool empty() const noexcept
+  {
+    return entries_.empty();
+  }
+
+  bool contains(const client& client) const noexcept
+  {
+    for (const auto& e : entries_) {
+      if ((client.hi() & e.mask_hi) == e.hi && (client.lo() & e.mask_lo) == e.lo) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  struct entry {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+    std::uint64_t mask_hi = 0;
+    std::uint64_t mask_lo = 0;
+  };
+
+  std::vector<entry> entries_;
+};
+
+// Returns the original client from a X-Forwarded-For header value by walking the chain from the right
+// and skipping trusted proxies. If the trusted table is empty, only the peer is trusted.
+client forwarded(std::string_view chain, const client& peer, const networks& trusted) noexcept;
+
+}  // namespace net
+
+template <>
+struct fmt::formatter<net::client> : fmt::formatter<std::string_view> {
+  template <typename FormatContext>
+  auto format(const net::client& client, FormatContext& context)
+  {
+    char buffer[32];
+    const auto size = client.format(buffer);
+    return fmt::formatter<std::string_view>::format(std::string_view{ buffer, size }, context);
+  }
+};
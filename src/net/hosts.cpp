@@ -0,0 +1,83 @@
+#include "hosts.hpp"
+#include <algorithm>
+
+namespace net {
+namespace {
+
+constexpr std::size_t name_size = 255;
+
+}  // namespace
+
+hosts::hosts(const app::config& config, const std::filesystem::path& html, const std::filesystem::path& data)
+{
+  // The vector is not resized after the names point into it.
+  hosts_.reserve(config.vhosts.size() + 1);
+  auto& fallback = hosts_.emplace_back();
+  fallback.html = html.string();
+  fallback.data = data.string();
+  fallback.proxied = config.server.proxied;
+  for (const auto& vhost : config.vhosts) {
+    auto& host = hosts_.emplace_back();
+    host.name = vhost.name;
+    host.html = vhost.html ? vhost.html->string() : fallback.html;
+    host.data = vhost.data ? vhost.data->string() : fallback.data;
+    if (!vhost.cache.empty()) {
+      host.cache = vhost.cache;
+      host.cache_field = fmt::format("Cache-Control: {}\r\n", vhost.cache);
+    }
+    host.proxied = vhost.proxied;
+    for (const auto& name : vhost.hosts) {
+      if (name.size() > name_size) {
+        throw std::runtime_error("Invalid vhost host (" + name + ")");
+      }
+      if (!names_.emplace(name, &host).second) {
+        throw std::runtime_error("Duplicate vhost host (" + name + ")");
+      }
+      LOGD("[:SERVER:] {} -> {}", name, host.html);
+    }
+  }
+}
+
+const host& hosts::find(std::string_view name) const noexcept
+{
+  if (names_.empty()) {
+    return hosts_.front();
+  }
+
+  // Remove the port and a trailing dot.
+  if (name.starts_with('[')) {
+    name = name.substr(0, name.find(']') + 1);
+  } else {
+    name = name.substr(0, name.find(':'));
+  }
+  if (name.ends_with('.')) {
+    name.remove_suffix(1);
+  }
+  if (name.empty() || name.size() > name_size) {
+    return hosts_.front();
+  }
+
+  // Compare lowercase names without allocating.
+  std::array<char, name_size> buffer;
+  std::transform(name.begin(), name.end(), buffer.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  const auto size = name.size();
+  if (const auto it = names_.find(std::string_view{ buffer.data(), size }); it != names_.end()) {
+    return *it->second;
+  }
+
+  // Replace the last character of every label with "*" to probe for "*.<suffix>".
+  for (std::size_t pos = 1; pos < size; pos++) {
+    if (buffer[pos] != '.') {
+      continue;
+    }
+    buffer[pos - 1] = '*';
+    if (const auto it = names_.find(std::string_view{ buffer.data() + pos - 1, size - pos + 1 }); it != names_.end()) {
+      return *it->second;
+    }
+  }
+  return hosts_.front();
+}
+
+}  // namespace net
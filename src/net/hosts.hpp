@@ -0,0 +1,54 @@
+#pragma once
+#include <app/config.hpp>
+#include <unordered_map>
+
+namespace net {
+
+// Virtual host with its own document roots.
+struct host {
+  std::string name;
+  std::string html;
+  std::string data;
+
+  // Cache-Control field value for files and the encoded field, or empty strings.
+  std::string cache;
+  std::string cache_field;
+
+  bool proxied = false;
+};
+
+// Table of virtual hosts by name, built once from the config.
+// Exact names take a single hash probe. Names that are not found are retried as wildcards, starting with the
+// longest suffix, so "*.example.com" matches every subdomain of "example.com". Unknown names resolve to the
+// default host, which uses the html and data directories from the command line.
+class hosts {
+public:
+  hosts(const app::config& config, const std::filesystem::path& html, const std::filesystem::path& data);
+
+  hosts(hosts&& other) = delete;
+  hosts(const hosts& other) = delete;
+  hosts& operator=(hosts&& other) = delete;
+  hosts& operator=(const hosts& other) = delete;
+
+  // Returns the host for a Host field value, which may include a port.
+  const host& find(std::string_view name) const noexcept;
+
+  const std::vector<host>& all() const noexcept
+  {
+    return hosts_;
+  }
+
+private:
+  struct hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view key) const noexcept
+    {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  std::vector<host> hosts_;
+  std::unordered_map<std::string, const host*, hash, std::equal_to<>> names_;
+};
+
+}  // namespace net
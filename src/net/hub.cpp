@@ -0,0 +1,132 @@
+#include "hub.hpp"
+#include <algorithm>
+
+namespace net {
+
+hub::subscriber::subscriber(std::string channel, executor_type executor, std::size_t limit, std::size_t bytes) :
+  channel_(std::move(channel)), limit_(limit), bytes_limit_(bytes), timer_(executor)
+{}
+
+bool hub::subscriber::push(const message& message)
+{
+  {
+    std::lock_guard lock{ mutex_ };
+    if (closed_) {
+      return !evicted_;
+    }
+    if (queue_.size() >= limit_ || bytes_ + message->size() > bytes_limit_) {
+      queue_.clear();
+      bytes_ = 0;
+      closed_ = true;
+      evicted_ = true;
+    } else {
+      queue_.push_back(message);
+      bytes_ += message->size();
+    }
+    if (!waiting_) {
+      return !evicted_;
+    }
+    waiting_ = false;
+  }
+  wake();
+  return !evicted();
+}
+
+auto hub::subscriber::pop() -> asio::awaitable<message>
+{
+  while (true) {
+    {
+      std::lock_guard lock{ mutex_ };
+      if (!queue_.empty()) {
+        auto message = std::move(queue_.front());
+        queue_.pop_front();
+        bytes_ -= message->size();
+        co_return message;
+      }
+      if (closed_) {
+        co_return message{};
+      }
+      waiting_ = true;
+      timer_.expires_at(asio::steady_timer::time_point::max());
+    }
+    boost::system::error_code ec;
+    co_await timer_.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  }
+}
+
+void hub::subscriber::close() noexcept
+{
+  {
+    std::lock_guard lock{ mutex_ };
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    if (!waiting_) {
+      return;
+    }
+    waiting_ = false;
+  }
+  wake();
+}
+
+void hub::subscriber::wake()
+{
+  // The timer is only touched on the executor of the subscriber.
+  asio::post(timer_.get_executor(), [self = shared_from_this()]() {
+    self->timer_.cancel();
+  });
+}
+
+hub::hub(const app::config& config) : limit_(config.websocket.queue), bytes_(config.websocket.bytes) {}
+
+auto hub::subscribe(std::string channel, executor_type executor) -> std::shared_ptr<subscriber>
+{
+  auto result = std::make_shared<subscriber>(channel, executor, limit_, bytes_);
+  auto& shard = shards_[next_.fetch_add(1, std::memory_order_relaxed) % shard_count];
+  std::lock_guard lock{ shard.mutex };
+  shard.channels[std::move(channel)].push_back(result);
+  return result;
+}
+
+void hub::unsubscribe(const std::shared_ptr<subscriber>& subscriber)
+{
+  subscriber->close();
+  for (auto& shard : shards_) {
+    std::lock_guard lock{ shard.mutex };
+    const auto channel = shard.channels.find(subscriber->channel());
+    if (channel == shard.channels.end()) {
+      continue;
+    }
+    auto& subscribers = channel->second;
+    if (const auto it = std::find(subscribers.begin(), subscribers.end(), subscriber); it != subscribers.end()) {
+      *it = std::move(subscribers.back());
+      subscribers.pop_back();
+      if (subscribers.empty()) {
+        shard.channels.erase(channel);
+      }
+      return;
+    }
+  }
+}
+
+std::size_t hub::publish(std::string_view channel, std::string data)
+{
+  const auto message = std::make_shared<const std::string>(std::move(data));
+  std::size_t count = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard lock{ shard.mutex };
+    const auto it = shard.channels.find(channel);
+    if (it == shard.channels.end()) {
+      continue;
+    }
+    for (const auto& subscriber : it->second) {
+      if (subscriber->push(message)) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+}  // namespace net
@@ -0,0 +1,88 @@
+#pragma once
+#include <app/config.hpp>
+#include <array>
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace net {
+
+// Publish/subscribe hub for WebSocket and event stream sessions.
+// A published message is stored once in a shared buffer and queued for every subscriber of the channel.
+// The server publishes key-value store changes to the "kv" channel. Clients publish to their channel only when
+// the publish option is set.
+class hub {
+public:
+  using message = std::shared_ptr<const std::string>;
+  using executor_type = asio::steady_timer::executor_type;
+
+  class subscriber : public std::enable_shared_from_this<subscriber> {
+  public:
+    subscriber(std::string channel, executor_type executor, std::size_t limit, std::size_t bytes);
+
+    // Queues a message. Returns false if the queue is full and the subscriber was evicted.
+    // Can be called from any thread.
+    bool push(const message& message);
+
+    // Waits for the next message. Returns an empty message if the subscriber was closed.
+    // Must be called from the executor that was passed to the constructor.
+    auto pop() -> asio::awaitable<message>;
+
+    // Closes the subscriber and wakes pop().
+    void close() noexcept;
+
+    const std::string& channel() const noexcept
+    {
+      return channel_;
+    }
+
+    bool evicted() const noexcept
+    {
+      std::lock_guard lock{ mutex_ };
+      return evicted_;
+    }
+
+  private:
+    void wake();
+
+    const std::string channel_;
+    const std::size_t limit_;
+    const std::size_t bytes_limit_;
+    asio::steady_timer timer_;
+    mutable std::mutex mutex_;
+    std::deque<message> queue_;
+    std::size_t bytes_ = 0;
+    bool waiting_ = false;
+    bool closed_ = false;
+    bool evicted_ = false;
+  };
+
+  hub(const app::config& config);
+
+  hub(hub&& other) = delete;
+  hub(const hub& other) = delete;
+  hub& operator=(hub&& other) = delete;
+  hub& operator=(const hub& other) = delete;
+
+  auto subscribe(std::string channel, executor_type executor) -> std::shared_ptr<subscriber>;
+  void unsubscribe(const std::shared_ptr<subscriber>& subscriber);
+
+  // Publishes a message to all subscribers of the channel. Can be called from any thread.
+  // Returns the number of subscribers the message was queued for.
+  std::size_t publish(std::string_view channel, std::string data);
+
+private:
+  static constexpr std::size_t shard_count = 16;
+
+  struct shard {
+    std::mutex mutex;
+    std::map<std::string, std::vector<std::shared_ptr<subscriber>>, std::less<>> channels;
+  };
+
+  const std::size_t limit_;
+  const std::size_t bytes_;
+  std::atomic<std::size_t> next_ = 0;
+  std::array<shard, shard_count> shards_;
+};
+
+}  // namespace net
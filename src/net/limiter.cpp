@@ -0,0 +1,127 @@
+#include "limiter.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace net {
+namespace {
+
+constexpr std::uint64_t hash(std::uint64_t hi, std::uint64_t lo, std::uint32_t route) noexcept
+{
+  auto h = hi * 0x9E3779B97F4A7C15ULL ^ lo * 0xC2B2AE3D27D4EB4FULL ^ route * 0x165667B19E3779F9ULL;
+  h ^= h >> 31;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 29;
+  return h;
+}
+
+}  // namespace
+
+limiter::limiter(const app::config& config)
+{
+  std::uint32_t index = 0;
+  for (const auto& limit : config.limit.routes) {
+    route route;
+    route.index = index++;
+    route.prefix = limit.prefix;
+    route.rate = limit.rate;
+    route.burst = std::max(limit.burst, limit.rate);
+    route.bandwidth = limit.bandwidth;
+    routes_.push_back(std::move(route));
+  }
+  std::stable_sort(routes_.begin(), routes_.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.prefix.size() > rhs.prefix.size();
+  });
+  if (routes_.empty()) {
+    return;
+  }
+  const auto size = std::bit_ceil(std::max(config.limit.size / shard_count, probe_count));
+  mask_ = size - 1;
+  shards_ = std::make_unique<shard[]>(shard_count);
+  for (std::size_t i = 0; i < shard_count; i++) {
+    shards_[i].entries.resize(size);
+  }
+}
+
+bool limiter::acquire(const client& client, const route& route) noexcept
+{
+  if (!route.rate && !route.bandwidth) {
+    return true;
+  }
+  return update(client, route, [&](entry& entry) {
+    if (route.bandwidth && entry.bytes < 0.0) {
+      return false;
+    }
+    if (route.rate) {
+      if (entry.tokens < 1.0) {
+        return false;
+      }
+      entry.tokens -= 1.0;
+    }
+    return true;
+  });
+}
+
+auto limiter::charge(const client& client, const route& route, std::uint64_t bytes) noexcept -> clock::duration
+{
+  if (!route.bandwidth) {
+    return {};
+  }
+  double debt = 0.0;
+  update(client, route, [&](entry& entry) {
+    entry.bytes -= static_cast<double>(bytes);
+    debt = -entry.bytes;
+    return true;
+  });
+  if (debt <= 0.0) {
+    return {};
+  }
+  return std::chrono::ceil<clock::duration>(std::chrono::duration<double>(debt / route.bandwidth));
+}
+
+template <typename Handler>
+bool limiter::update(const client& client, const route& route, Handler&& handler) noexcept
+{
+  const auto time = clock::now().time_since_epoch().count();
+  const auto h = hash(client.hi(), client.lo(), route.index);
+  auto& shard = shards_[h & (shard_count - 1)];
+  while (shard.lock.test_and_set(std::memory_order_acquire)) {
+  }
+
+  // Find the entry or the least recently used slot in the probe window.
+  entry* match = nullptr;
+  entry* oldest = nullptr;
+  for (std::size_t i = 0; i < probe_count; i++) {
+    auto& entry = shard.entries[((h >> 6) + i) & mask_];
+    if (entry.used && entry.hi == client.hi() && entry.lo == client.lo() && entry.route == route.index) {
+      match = &entry;
+      break;
+    }
+    if (!oldest || !entry.used || (oldest->used && entry.time < oldest->time)) {
+      oldest = &entry;
+    }
+  }
+  if (!match) {
+    match = oldest;
+    match->hi = client.hi();
+    match->lo = client.lo();
+    match->route = route.index;
+    match->used = true;
+    match->tokens = route.burst;
+    match->bytes = route.bandwidth;
+    match->time = time;
+  }
+
+  // Refill the buckets.
+  const auto seconds = std::chrono::duration<double>(clock::duration{ time - match->time }).count();
+  if (seconds > 0.0) {
+    match->tokens = std::min(route.burst, match->tokens + seconds * route.rate);
+    match->bytes = std::min(route.bandwidth, match->bytes + seconds * route.bandwidth);
+    match->time = time;
+  }
+
+  const auto result = handler(*match);
+  shard.lock.clear(std::memory_order_release);
+  return result;
+}
+
+}  // namespace net
@@ -0,0 +1,76 @@
+#pragma once
+#include <app/config.hpp>
+#include <net/client.hpp>
+#include <atomic>
+
+namespace net {
+
+// Per-client token buckets for request rate and bandwidth, keyed by client address and route prefix.
+// The table is split into shards with a fixed number of slots. When a shard is full, the least recently
+// used entry in the probe window is reused, which bounds memory and ages out idle clients.
+class limiter {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct route {
+    std::uint32_t index = 0;
+    std::string prefix;
+    double rate = 0.0;
+    double burst = 0.0;
+    double bandwidth = 0.0;
+  };
+
+  limiter(const app::config& config);
+
+  limiter(limiter&& other) = delete;
+  limiter(const limiter& other) = delete;
+  limiter& operator=(limiter&& other) = delete;
+  limiter& operator=(const limiter& other) = delete;
+
+  // Returns the route with the longest prefix that matches the target or nullptr.
+  const route* match(std::string_view target) const noexcept
+  {
+    for (const auto& route : routes_) {
+      if (target.starts_with(route.prefix)) {
+        return &route;
+      }
+    }
+    return nullptr;
+  }
+
+  // Takes a request token and checks that the client is not over its bandwidth.
+  // Returns false if the request must be rejected.
+  bool acquire(const client& client, const route& route) noexcept;
+
+  // Charges bytes against the bandwidth of the client. The bucket may go into debt.
+  // Returns the time until the debt is paid off, which is how long the sender should pause.
+  clock::duration charge(const client& client, const route& route, std::uint64_t bytes) noexcept;
+
+private:
+  static constexpr std::size_t shard_count = 64;
+  static constexpr std::size_t probe_count = 8;
+
+  struct entry {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+    std::uint32_t route = 0;
+    bool used = false;
+    double tokens = 0.0;
+    double bytes = 0.0;
+    clock::rep time = 0;
+  };
+
+  struct alignas(64) shard {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    std::vector<entry> entries;
+  };
+
+  template <typename Handler>
+  bool update(const client& client, const route& route, Handler&& handler) noexcept;
+
+  std::vector<route> routes_;
+  std::size_t mask_ = 0;
+  std::unique_ptr<shard[]> shards_;
+};
+
+}  // namespace net
@@ -0,0 +1,197 @@
+#include "notifier.hpp"
+#include <array>
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+namespace {
+
+#ifndef _WIN32
+
+constexpr std::uint32_t notifier_mask = IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO | IN_CREATE;
+
+bool readable(const std::string& file) noexcept
+{
+  if (const auto fd = ::open(file.data(), O_RDONLY | O_CLOEXEC); fd != -1) {
+    ::close(fd);
+    return true;
+  }
+  return false;
+}
+
+#endif
+
+}  // namespace
+
+notifier::notifier(executor_type executor) : executor_(executor) {}
+
+notifier::~notifier()
+{
+#ifndef _WIN32
+  if (stream_) {
+    boost::system::error_code ec;
+    stream_->close(ec);
+  }
+#endif
+}
+
+auto notifier::wait(const std::string& file, clock::time_point deadline) -> asio::awaitable<bool>
+{
+  if (clock::now() >= deadline) {
+    co_return false;
+  }
+#ifdef _WIN32
+  asio::steady_timer timer{ executor_ };
+  timer.expires_at(std::min(deadline, clock::now() + std::chrono::milliseconds{ 20 }));
+  boost::system::error_code ec;
+  co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  co_return clock::now() < deadline;
+#else
+  std::shared_ptr<entry> entry;
+  {
+    std::lock_guard lock{ mutex_ };
+    if (const auto it = entries_.find(file); it != entries_.end()) {
+      entry = it->second;
+    } else {
+      const auto pos = file.rfind('/');
+      auto directory = pos == std::string::npos ? std::string(".") : file.substr(0, pos ? pos : 1);
+      auto& watch = watches_[directory];
+      if (watch.descriptor == -1) {
+        if (!stream_) {
+          const auto fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+          if (fd == -1) {
+            watches_.erase(directory);
+            throw std::system_error(errno, std::generic_category(), "Could not initialize inotify");
+          }
+          stream_.emplace(executor_, fd);
+          asio::co_spawn(executor_, read(), asio::detached);
+        }
+        const auto wd = ::inotify_add_watch(stream_->native_handle(), directory.data(), notifier_mask);
+        if (wd == -1) {
+          watches_.erase(directory);
+          throw std::system_error(errno, std::generic_category(), "Could not watch directory");
+        }
+        watch.descriptor = wd;
+        directories_[wd] = directory;
+      }
+      watch.count++;
+      entry = std::make_shared<struct entry>(executor_, std::move(directory));
+      entry->timer.expires_at(deadline);
+      entries_.emplace(file, entry);
+    }
+  }
+
+  // The file could have become readable before the watch was installed.
+  if (readable(file)) {
+    notify(file);
+    co_return true;
+  }
+
+  // The timer expires at the deadline of the first waiter or when notify() moves the expiry into the past.
+  boost::system::error_code ec;
+  co_await entry->timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+  if (!ec) {
+    release(file, entry);
+  }
+  co_return clock::now() < deadline;
+#endif
+}
+
+auto notifier::read() -> asio::awaitable<void>
+{
+#ifndef _WIN32
+  alignas(inotify_event) std::array<char, 4096> buffer;
+  while (true) {
+    boost::system::error_code ec;
+    const auto size =
+      co_await stream_->async_read_some(asio::buffer(buffer), asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      if (ec != asio::error::operation_aborted) {
+        LOGE("[NOTIFIER] {}: {} ({})", ec.category().name(), ec.message(), ec.value());
+      }
+      co_return;
+    }
+    for (std::size_t pos = 0; pos + sizeof(inotify_event) <= size;) {
+      const auto event = reinterpret_cast<const inotify_event*>(buffer.data() + pos);
+      pos += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        // Events were lost; wake everyone so that they can retry.
+        std::vector<std::string> files;
+        {
+          std::lock_guard lock{ mutex_ };
+          for (const auto& [file, entry] : entries_) {
+            files.push_back(file);
+          }
+        }
+        for (const auto& file : files) {
+          notify(file);
+        }
+        continue;
+      }
+      if (!event->len) {
+        continue;
+      }
+      std::string file;
+      {
+        std::lock_guard lock{ mutex_ };
+        const auto it = directories_.find(event->wd);
+        if (it == directories_.end()) {
+          continue;
+        }
+        file = it->second;
+      }
+      if (file.back() != '/') {
+        file.push_back('/');
+      }
+      file.append(event->name);
+      notify(file);
+    }
+  }
+#else
+  co_return;
+#endif
+}
+
+void notifier::notify(const std::string& file)
+{
+  std::shared_ptr<entry> entry;
+  {
+    std::lock_guard lock{ mutex_ };
+    const auto it = entries_.find(file);
+    if (it == entries_.end()) {
+      return;
+    }
+    entry = it->second;
+  }
+
+  // Moving the expiry cancels pending waits and completes future waits immediately.
+  entry->timer.expires_at(clock::time_point::min());
+  release(file, entry);
+}
+
+void notifier::release(const std::string& file, const std::shared_ptr<entry>& entry)
+{
+  std::lock_guard lock{ mutex_ };
+  const auto it = entries_.find(file);
+  if (it == entries_.end() || it->second != entry) {
+    return;
+  }
+  entries_.erase(it);
+  const auto watch = watches_.find(entry->directory);
+  if (watch == watches_.end() || --watch->second.count) {
+    return;
+  }
+#ifndef _WIN32
+  if (stream_) {
+    ::inotify_rm_watch(stream_->native_handle(), watch->second.descriptor);
+  }
+#endif
+  directories_.erase(watch->second.descriptor);
+  watches_.erase(watch);
+}
+
+}  // namespace net
@@ -0,0 +1,55 @@
+#pragma once
+#include <common.hpp>
+#include <map>
+#include <mutex>
+
+namespace net {
+
+// Parks sessions that wait for a file to become readable.
+// All waiters for the same path share one directory watch and one timer and are woken together
+// when the file is closed after writing, its attributes change or it is moved into place.
+class notifier {
+public:
+  using clock = std::chrono::steady_clock;
+  using executor_type = asio::steady_timer::executor_type;
+
+  notifier(executor_type executor);
+
+  notifier(notifier&& other) = delete;
+  notifier(const notifier& other) = delete;
+  notifier& operator=(notifier&& other) = delete;
+  notifier& operator=(const notifier& other) = delete;
+
+  ~notifier();
+
+  // Waits until the file changes or the deadline is reached.
+  // Returns false if the deadline was reached.
+  auto wait(const std::string& file, clock::time_point deadline) -> asio::awaitable<bool>;
+
+private:
+  struct entry {
+    entry(executor_type executor, std::string directory) : timer(executor), directory(std::move(directory)) {}
+    asio::steady_timer timer;
+    std::string directory;
+  };
+
+  struct watch {
+    int descriptor = -1;
+    std::size_t count = 0;
+  };
+
+  auto read() -> asio::awaitable<void>;
+  void notify(const std::string& file);
+  void release(const std::string& file, const std::shared_ptr<entry>& entry);
+
+  executor_type executor_;
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<entry>, std::less<>> entries_;
+  std::map<std::string, watch, std::less<>> watches_;
+  std::map<int, std::string> directories_;
+#ifndef _WIN32
+  std::optional<asio::posix::stream_descriptor> stream_;
+#endif
+};
+
+}  // namespace net
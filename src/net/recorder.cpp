@@ -0,0 +1,225 @@
+#include "recorder.hpp"
+#include <app/cpu.hpp>
+#include <ctime>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace net {
+namespace {
+
+std::tm local(std::time_t time) noexcept
+{
+  std::tm tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &time);
+#else
+  localtime_r(&time, &tm);
+#endif
+  return tm;
+}
+
+template <typename T>
+void append(std::string& buffer, const std::vector<T>& column)
+{
+  const auto size = column.size() * sizeof(T);
+  buffer.append(reinterpret_cast<const char*>(column.data()), size);
+  buffer.append(access::align(size) - size, '\0');
+}
+
+// Opens a file for appending.
+int open_append(const std::filesystem::path& filename)
+{
+#ifdef _WIN32
+  const auto handle = ::_wopen(filename.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  const auto handle = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+#endif
+  if (handle == -1) {
+    throw std::system_error(errno, std::generic_category(), "Could not open access log (" + filename.string() + ")");
+  }
+  return handle;
+}
+
+void close_file(int handle) noexcept
+{
+#ifdef _WIN32
+  ::_close(handle);
+#else
+  ::close(handle);
+#endif
+}
+
+}  // namespace
+
+recorder::recorder(const app::config& config) : filename_(*config.access.filename)
+{
+  rotate(std::chrono::system_clock::now());
+  thread_ = std::thread([this, cpus = config.cpu.background]() {
+    app::pin(cpus, "access");
+    run();
+  });
+}
+
+recorder::~recorder()
+{
+  {
+    std::lock_guard lock{ mutex_ };
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+  if (file_ != -1) {
+    close_file(file_);
+  }
+}
+
+void recorder::record(const net::client& client, http::verb method, unsigned status, std::uint64_t bytes,
+  std::uint64_t latency, std::string_view target)
+{
+  const auto now = std::chrono::system_clock::now();
+  if (const auto pos = target.find('?'); pos != std::string_view::npos) {
+    target = target.substr(0, pos);
+  }
+
+  std::unique_lock lock{ mutex_ };
+  if (now >= next_) {
+    flush();
+    rotate(now);
+  }
+  if (block_.time.empty()) {
+    block_.filename = current_;
+    block_.created = std::chrono::steady_clock::now();
+  }
+
+  auto id = access::overflow;
+  if (const auto it = targets_.find(target); it != targets_.end()) {
+    id = it->second;
+  } else if (targets_.size() < access::targets) {
+    id = static_cast<std::uint32_t>(targets_.size());
+    targets_.emplace(target, id);
+    const access::name name{ id, static_cast<std::uint32_t>(target.size()) };
+    block_.names.append(reinterpret_cast<const char*>(&name), sizeof(name));
+    block_.names.append(target);
+    block_.names.append(access::align(target.size()) - target.size(), '\0');
+    block_.name_count++;
+  }
+
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+  block_.time.push_back(static_cast<std::int64_t>(us));
+  block_.hi.push_back(client.hi());
+  block_.lo.push_back(client.lo());
+  block_.bytes.push_back(bytes);
+  block_.latency.push_back(static_cast<std::uint32_t>(std::min<std::uint64_t>(latency, 0xFFFFFFFF)));
+  block_.target.push_back(id);
+  block_.status.push_back(static_cast<std::uint16_t>(status));
+  block_.method.push_back(static_cast<std::uint8_t>(method));
+  if (block_.time.size() >= access::records) {
+    flush();
+    lock.unlock();
+    cv_.notify_one();
+  }
+}
+
+void recorder::rotate(std::chrono::system_clock::time_point now)
+{
+  // Use the same naming scheme as the daily log file.
+  auto tm = local(std::chrono::system_clock::to_time_t(now));
+  auto stem = filename_.stem().string();
+  current_ = filename_.parent_path() / fmt::format("{}-{:04d}-{:02d}-{:02d}{}", stem, tm.tm_year + 1900,
+    tm.tm_mon + 1, tm.tm_mday, filename_.extension().string());
+  tm.tm_hour = 0;
+  tm.tm_min = 0;
+  tm.tm_sec = 0;
+  tm.tm_mday++;
+  tm.tm_isdst = -1;
+  next_ = std::chrono::system_clock::from_time_t(std::mktime(&tm));
+}
+
+void recorder::flush()
+{
+  if (!block_.time.empty()) {
+    queue_.push_back(std::move(block_));
+    block_ = {};
+  }
+  targets_.clear();
+}
+
+void recorder::run()
+{
+  std::vector<block> blocks;
+  std::unique_lock lock{ mutex_ };
+  while (true) {
+    cv_.wait_for(lock, std::chrono::seconds(1), [this]() {
+      return stop_ || !queue_.empty();
+    });
+    const auto stop = stop_;
+    if (stop || (!block_.time.empty() && std::chrono::steady_clock::now() - block_.created >= std::chrono::seconds(1))) {
+      flush();
+    }
+    blocks.swap(queue_);
+    lock.unlock();
+    for (const auto& block : blocks) {
+      try {
+        write(block);
+      }
+      catch (const std::exception& e) {
+        LOGE("[:ACCESS:] {}", e.what());
+      }
+    }
+    blocks.clear();
+    if (stop) {
+      break;
+    }
+    lock.lock();
+  }
+}
+
+void recorder::write(const block& block)
+{
+  if (open_ != block.filename || file_ == -1) {
+    if (file_ != -1) {
+      close_file(file_);
+      file_ = -1;
+    }
+    file_ = open_append(block.filename);
+    open_ = block.filename;
+  }
+
+  const auto count = static_cast<std::uint32_t>(block.time.size());
+  access::header header;
+  header.count = count;
+  header.names = block.name_count;
+  header.size = static_cast<std::uint32_t>(
+    sizeof(header) + access::offset(access::column::count, count) + block.names.size());
+
+  buffer_.clear();
+  buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  append(buffer_, block.time);
+  append(buffer_, block.hi);
+  append(buffer_, block.lo);
+  append(buffer_, block.bytes);
+  append(buffer_, block.latency);
+  append(buffer_, block.target);
+  append(buffer_, block.status);
+  append(buffer_, block.method);
+  buffer_.append(block.names);
+
+  // Appends of a whole block are not interleaved with the blocks of other processes.
+#ifdef _WIN32
+  const auto size = ::_write(file_, buffer_.data(), static_cast<unsigned>(buffer_.size()));
+#else
+  const auto size = ::write(file_, buffer_.data(), buffer_.size());
+#endif
+  if (size < 0 || static_cast<std::size_t>(size) != buffer_.size()) {
+    throw std::system_error(size < 0 ? errno : ENOSPC, std::generic_category(),
+      "Could not write access log (" + block.filename.string() + ")");
+  }
+}
+
+}  // namespace net
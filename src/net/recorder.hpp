@@ -0,0 +1,83 @@
+#pragma once
+#include <app/config.hpp>
+#include <net/access.hpp>
+#include <net/client.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace net {
+
+// Writes access records to a binary log file that is rotated daily (see net/access.hpp).
+// Records are collected in columns and written by a background thread when a block is full or one second old.
+// Every block carries its own target names and is written with a single append, so that restarted and worker
+// processes can share a file.
+class recorder {
+public:
+  recorder(const app::config& config);
+
+  recorder(recorder&& other) = delete;
+  recorder(const recorder& other) = delete;
+  recorder& operator=(recorder&& other) = delete;
+  recorder& operator=(const recorder& other) = delete;
+
+  ~recorder();
+
+  void record(const net::client& client, http::verb method, unsigned status, std::uint64_t bytes,
+    std::uint64_t latency, std::string_view target);
+
+private:
+  struct block {
+    std::filesystem::path filename;
+    std::chrono::steady_clock::time_point created;
+    std::vector<std::int64_t> time;
+    std::vector<std::uint64_t> hi;
+    std::vector<std::uint64_t> lo;
+    std::vector<std::uint64_t> bytes;
+    std::vector<std::uint32_t> latency;
+    std::vector<std::uint32_t> target;
+    std::vector<std::uint16_t> status;
+    std::vector<std::uint8_t> method;
+    std::string names;
+    std::uint32_t name_count = 0;
+  };
+
+  struct hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view key) const noexcept
+    {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  // Starts a new file for the day of the given time.
+  void rotate(std::chrono::system_clock::time_point now);
+
+  // Moves the current block to the queue.
+  void flush();
+
+  void run();
+  void write(const block& block);
+
+  const std::filesystem::path filename_;
+
+  // Protects the current block, the target ids and the queue.
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  block block_;
+  std::vector<block> queue_;
+  std::unordered_map<std::string, std::uint32_t, hash, std::equal_to<>> targets_;
+  std::filesystem::path current_;
+  std::chrono::system_clock::time_point next_;
+  bool stop_ = false;
+
+  // Only used by the background thread.
+  int file_ = -1;
+  std::filesystem::path open_;
+  std::string buffer_;
+
+  std::thread thread_;
+};
+
+}  // namespace net
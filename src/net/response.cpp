@@ -0,0 +1,198 @@
+#include "response.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <ctime>
+
+namespace net {
+namespace {
+
+constexpr std::array<std::string_view, 3> content_types{ "application/octet-stream", "application/json", "text/html" };
+
+// clang-format off
+constexpr std::array<std::tuple<http::status, std::string_view, std::string_view>, 7> error_pages{ {
+  { http::status::use_proxy,             "",                  "<code>Reverse proxy required. See server log for details.</code>" },
+  { http::status::bad_request,           "",                  "<code>Bad request.</code>" },
+  { http::status::not_found,             "",                  "<code>The requested resource was not found.</code>" },
+  { http::status::too_many_requests,     "Retry-After: 1\r\n", "<code>Too many requests.</code>" },
+  { http::status::internal_server_error, "",                  "<code>An internal server error occurred.</code>" },
+  { http::status::bad_gateway,           "",                  "<code>The upstream server is not available.</code>" },
+  { http::status::gateway_timeout,       "",                  "<code>The upstream server did not respond in time.</code>" },
+} };
+// clang-format on
+
+std::string encode(std::string_view content_type)
+{
+  return fmt::format("Server: {}\r\nContent-Type: {}\r\n", SERVER_VERSION_STRING, content_type);
+}
+
+}  // namespace
+
+headers::headers()
+{
+  for (const auto type : content_types) {
+    fields_.emplace_back(type, encode(type));
+  }
+  update();
+}
+
+auto headers::run() -> asio::awaitable<void>
+{
+  asio::system_timer timer{ co_await asio::this_coro::executor };
+  while (true) {
+    // Wake up right after the next second starts.
+    const auto now = std::chrono::system_clock::now();
+    timer.expires_at(std::chrono::ceil<std::chrono::seconds>(now));
+    co_await timer.async_wait(asio::use_awaitable);
+    update();
+  }
+}
+
+std::string_view headers::fields(std::string_view content_type) const noexcept
+{
+  for (const auto& [type, fields] : fields_) {
+    if (type == content_type) {
+      return fields;
+    }
+  }
+  return {};
+}
+
+void headers::update() noexcept
+{
+  // clang-format off
+  constexpr std::array<std::string_view, 7> days{ "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+  constexpr std::array<std::string_view, 12> months{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+  // clang-format on
+
+  const auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  std::tm tm{};
+#ifdef _WIN32
+  gmtime_s(&tm, &time);
+#else
+  gmtime_r(&time, &tm);
+#endif
+  fmt::format_to_n(date_.data(), date_.size(), "Date: {}, {:02d} {} {:04d} {:02d}:{:02d}:{:02d} GMT\r\n",
+    days[static_cast<std::size_t>(tm.tm_wday)], tm.tm_mday, months[static_cast<std::size_t>(tm.tm_mon)],
+    tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+response::response(const net::headers& headers, http::status status, unsigned version, bool keep_alive,
+  std::string_view content_type) :
+  status_(status), fields_(headers.fields(content_type)), version_(version)
+{
+  if (fields_.empty()) {
+    dynamic_ = encode(content_type);
+  }
+  start(headers, version);
+  this->keep_alive(keep_alive);
+  content_length(0);
+}
+
+response::response(const net::headers& headers, http::status status, unsigned version, bool keep_alive,
+  const net::type& type) :
+  status_(status), fields_(type.fields), version_(version)
+{
+  start(headers, version);
+  this->keep_alive(keep_alive);
+  content_length(0);
+}
+
+response::response(const net::headers& headers, http::status status, bool keep_alive, std::string_view head,
+  std::string_view tail) noexcept :
+  status_(status), keep_alive_(keep_alive), fields_(head), tail_(tail)
+{
+  const auto date = headers.date();
+  std::copy(date.begin(), date.end(), date_.begin());
+}
+
+void response::start(const net::headers& headers, unsigned version) noexcept
+{
+  const auto result = fmt::format_to_n(status_line_.data(), status_line_.size(), "HTTP/{}.{} {:03d} {}\r\n",
+    version / 10, version % 10, static_cast<unsigned>(status_), http::obsolete_reason(status_));
+  status_line_size_ = std::min(result.size, status_line_.size());
+  const auto date = headers.date();
+  std::copy(date.begin(), date.end(), date_.begin());
+}
+
+void response::keep_alive(bool value) noexcept
+{
+  keep_alive_ = value;
+  if (version_ > 10) {
+    connection_ = value ? std::string_view{} : "Connection: close\r\n";
+  } else {
+    connection_ = value ? "Connection: keep-alive\r\n" : std::string_view{};
+  }
+}
+
+void response::body(std::string body)
+{
+  body_ = std::move(body);
+  content_length(body_.size());
+}
+
+void response::content_length(std::uint64_t size)
+{
+  const auto result = fmt::format_to_n(content_length_.data(), content_length_.size(), "Content-Length: {}\r\n\r\n", size);
+  content_length_size_ = result.size;
+}
+
+std::array<asio::const_buffer, 8> response::buffers() const noexcept
+{
+  const auto fields = fields_.empty() ? std::string_view{ dynamic_ } : fields_;
+  return {
+    asio::buffer(status_line_.data(), status_line_size_),
+    asio::buffer(fields.data(), fields.size()),
+    asio::buffer(date_.data(), date_.size()),
+    asio::buffer(field_.data(), field_.size()),
+    asio::buffer(connection_.data(), connection_.size()),
+    asio::buffer(content_length_.data(), content_length_size_),
+    asio::buffer(body_.data(), body_.size()),
+    asio::buffer(tail_.data(), tail_.size()),
+  };
+}
+
+errors::errors(const std::filesystem::path& html)
+{
+  for (const auto& [status, field, builtin] : error_pages) {
+    auto& page = pages_.emplace_back();
+    page.status = status;
+    std::string body{ builtin };
+    const auto code = static_cast<unsigned>(status);
+    if (std::ifstream file{ html / fmt::format("{}.html", code), std::ios::binary }) {
+      body.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      LOGD("[:SERVER:] Loaded {} error page", code);
+    }
+    for (std::size_t i = 0; i < page.head.size(); i++) {
+      const auto version = i < 2 ? 10 : 11;
+      const auto keep_alive = i % 2 == 1;
+      auto connection = std::string_view{};
+      if (version > 10 && !keep_alive) {
+        connection = "Connection: close\r\n";
+      } else if (version == 10 && keep_alive) {
+        connection = "Connection: keep-alive\r\n";
+      }
+      page.head[i] = fmt::format("HTTP/1.{} {:03d} {}\r\n{}", version % 10, code, http::obsolete_reason(status),
+        encode("text/html"));
+      page.tail[i] = fmt::format("{}{}Content-Length: {}\r\n\r\n{}", field, connection, body.size(), body);
+    }
+  }
+}
+
+net::response errors::operator()(const net::headers& headers, http::status status, unsigned version,
+  bool keep_alive) const noexcept
+{
+  auto it = std::find_if(pages_.begin(), pages_.end(), [status](const page& page) {
+    return page.status == status;
+  });
+  if (it == pages_.end()) {
+    it = std::find_if(pages_.begin(), pages_.end(), [](const page& page) {
+      return page.status == http::status::internal_server_error;
+    });
+  }
+  const auto i = (version > 10 ? 2 : 0) + (keep_alive ? 1 : 0);
+  return { headers, it->status, keep_alive, it->head[i], it->tail[i] };
+}
+
+}  // namespace net
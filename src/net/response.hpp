@@ -0,0 +1,138 @@
+#pragma once
+#include <common.hpp>
+#include <net/types.hpp>
+#include <version.h>
+#include <array>
+
+#define SERVER_VERSION_STRING PROJECT_NAME "/" PROJECT_VERSION
+
+namespace net {
+
+// Pre-encoded response header fields.
+// The Server and Content-Type fields are encoded once for the content types of generated responses.
+// The Date field is refreshed once per second by run().
+class headers {
+public:
+  headers();
+
+  headers(headers&& other) = delete;
+  headers(const headers& other) = delete;
+  headers& operator=(headers&& other) = delete;
+  headers& operator=(const headers& other) = delete;
+
+  // Refreshes the Date field until the executor is stopped.
+  auto run() -> asio::awaitable<void>;
+
+  // Returns the encoded Server and Content-Type fields or an empty string for unknown content types.
+  std::string_view fields(std::string_view content_type) const noexcept;
+
+  // Returns the encoded Date field.
+  std::string_view date() const noexcept
+  {
+    return { date_.data(), date_size };
+  }
+
+  // Returns the Date field value.
+  std::string_view date_value() const noexcept
+  {
+    return { date_.data() + 6, date_size - 8 };
+  }
+
+  // Size of the encoded Date field.
+  static constexpr std::size_t date_size = 37;
+
+private:
+  void update() noexcept;
+
+  std::vector<std::pair<std::string_view, std::string>> fields_;
+  std::array<char, date_size> date_{};
+};
+
+// Response that is written as a sequence of pre-encoded buffers.
+class response {
+public:
+  response(const net::headers& headers, http::status status, unsigned version, bool keep_alive,
+    std::string_view content_type);
+
+  // Creates a response with the encoded fields of a file type. The type must outlive the response.
+  response(const net::headers& headers, http::status status, unsigned version, bool keep_alive,
+    const net::type& type);
+
+  // Creates a pre-rendered response from the blocks before and after the Date field.
+  // The blocks must outlive the response.
+  response(const net::headers& headers, http::status status, bool keep_alive, std::string_view head,
+    std::string_view tail) noexcept;
+
+  http::status result() const noexcept
+  {
+    return status_;
+  }
+
+  bool keep_alive() const noexcept
+  {
+    return keep_alive_;
+  }
+
+  // Sets the Connection field. Pre-rendered responses must not be changed.
+  void keep_alive(bool value) noexcept;
+
+  // Adds an encoded field, for example "Retry-After: 1\r\n". The string must outlive the response.
+  void set(std::string_view field) noexcept
+  {
+    field_ = field;
+  }
+
+  // Sets the body and the Content-Length field.
+  void body(std::string body);
+
+  // Sets the Content-Length field without changing the body.
+  void content_length(std::uint64_t size);
+
+  std::array<asio::const_buffer, 8> buffers() const noexcept;
+
+private:
+  void start(const net::headers& headers, unsigned version) noexcept;
+
+  http::status status_;
+  bool keep_alive_ = true;
+  std::string_view connection_;
+  std::string_view fields_;
+  std::string_view field_;
+  std::array<char, 64> status_line_{};
+  std::size_t status_line_size_ = 0;
+  std::array<char, headers::date_size> date_{};
+  std::array<char, 40> content_length_{};
+  std::size_t content_length_size_ = 0;
+  std::string dynamic_;
+  std::string body_;
+  std::string_view tail_;
+  unsigned version_ = 11;
+};
+
+// Pre-rendered error responses.
+// Pages are loaded from "<status>.html" in the html directory or built in. Each page is rendered once for
+// every HTTP version and connection mode, so that an error response only needs the current Date field.
+class errors {
+public:
+  errors(const std::filesystem::path& html);
+
+  errors(errors&& other) = delete;
+  errors(const errors& other) = delete;
+  errors& operator=(errors&& other) = delete;
+  errors& operator=(const errors& other) = delete;
+
+  // Returns the response for a status or an internal server error for unknown statuses.
+  net::response operator()(const net::headers& headers, http::status status, unsigned version,
+    bool keep_alive) const noexcept;
+
+private:
+  struct page {
+    http::status status = http::status::internal_server_error;
+    std::array<std::string, 4> head;
+    std::array<std::string, 4> tail;
+  };
+
+  std::vector<page> pages_;
+};
+
+}  // namespace net
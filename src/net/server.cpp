@@ -1,34 +1,279 @@
 #include "server.hpp"
+#include <app/stopwatch.hpp>
+#include <app/systemd.hpp>
 #include <net/session.hpp>
+#include <algorithm>
+#include <fstream>
 #include <version.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 namespace net {
+namespace {
+
+// Maximum number of connections accepted per wakeup.
+constexpr std::size_t accept_batch = 64;
+
+// Delay before accepting again after an error that does not go away by itself (e.g. out of file descriptors).
+constexpr std::chrono::milliseconds accept_backoff{ 100 };
+
+// Maximum number of recycled read buffers and their maximum capacity.
+constexpr std::size_t buffer_count = 1024;
+constexpr std::size_t buffer_capacity = 65536;
+
+template <int Level, int Name>
+using integer_option = asio::detail::socket_option::integer<Level, Name>;
+
+// Sets a socket option and logs a warning if the system does not support it.
+template <typename Socket, typename Option>
+bool set_option(Socket& socket, const Option& option, std::string_view name)
+{
+  boost::system::error_code ec;
+  socket.set_option(option, ec);
+  if (ec) {
+    LOGW("[:SERVER:] Could not set {}: {} ({})", name, ec.message(), ec.value());
+    return false;
+  }
+  return true;
+}
+
+// Returns the protocol of an inherited listener socket.
+asio::ip::tcp protocol(int handle)
+{
+#ifndef _WIN32
+  sockaddr_storage address{};
+  socklen_t size = sizeof(address);
+  if (::getsockname(handle, reinterpret_cast<sockaddr*>(&address), &size) == 0 && address.ss_family == AF_INET6) {
+    return asio::ip::tcp::v6();
+  }
+#endif
+  return asio::ip::tcp::v4();
+}
+
+// Options that accepted sockets do not inherit from the acceptor.
+struct options {
+  options(const app::config& config) noexcept :
+    nodelay(config.server.nodelay), notsent_lowat(config.server.notsent_lowat),
+    busy_poll(static_cast<int>(config.server.busy_poll.count()))
+  {}
+
+  bool nodelay = false;
+  int notsent_lowat = 0;
+  int busy_poll = 0;
+};
+
+// Applies the options to an accepted socket.
+// Options that the system rejects are disabled, so that the warning is logged once and not for every connection.
+void configure(asio::ip::tcp::socket& socket, options& options)
+{
+  if (options.nodelay && !set_option(socket, asio::ip::tcp::no_delay{ true }, "TCP_NODELAY")) {
+    options.nodelay = false;
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  if (options.notsent_lowat > 0) {
+    const auto option = integer_option<IPPROTO_TCP, TCP_NOTSENT_LOWAT>{ options.notsent_lowat };
+    if (!set_option(socket, option, "TCP_NOTSENT_LOWAT")) {
+      options.notsent_lowat = 0;
+    }
+  }
+#endif
+#ifdef SO_BUSY_POLL
+  if (options.busy_poll > 0) {
+    if (!set_option(socket, integer_option<SOL_SOCKET, SO_BUSY_POLL>{ options.busy_poll }, "SO_BUSY_POLL")) {
+      options.busy_poll = 0;
+    }
+  }
+#endif
+}
+
+}  // namespace
+
+beast::flat_buffer server::buffer() noexcept
+{
+  if (buffers_->empty()) {
+    return {};
+  }
+  auto buffer = std::move(buffers_->back());
+  buffers_->pop_back();
+  return buffer;
+}
+
+void server::recycle(buffers& buffers, beast::flat_buffer& buffer) noexcept
+{
+  if (buffer.capacity() && buffer.capacity() <= buffer_capacity && buffers.size() < buffer_count) {
+    buffer.clear();
+    buffers.push_back(std::move(buffer));
+  }
+}
+
+asio::ip::tcp::acceptor server::listen(const app::config& config, const asio::any_io_executor& executor)
+{
+  auto resolver = asio::ip::tcp::resolver{ executor };
+  auto endpoint = resolver.resolve(config.server.address, config.server.service)->endpoint();
+  auto acceptor = asio::ip::tcp::acceptor{ executor };
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(asio::socket_base::reuse_address{ true });
+  if (config.server.sndbuf > 0) {
+    set_option(acceptor, asio::socket_base::send_buffer_size{ config.server.sndbuf }, "SO_SNDBUF");
+  }
+  if (config.server.rcvbuf > 0) {
+    set_option(acceptor, asio::socket_base::receive_buffer_size{ config.server.rcvbuf }, "SO_RCVBUF");
+  }
+#ifdef TCP_DEFER_ACCEPT
+  if (const auto seconds = static_cast<int>(config.server.defer_accept.count()); seconds > 0) {
+    set_option(acceptor, integer_option<IPPROTO_TCP, TCP_DEFER_ACCEPT>{ seconds }, "TCP_DEFER_ACCEPT");
+  }
+#endif
+#ifdef TCP_FASTOPEN
+  if (config.server.fastopen > 0) {
+    set_option(acceptor, integer_option<IPPROTO_TCP, TCP_FASTOPEN>{ config.server.fastopen }, "TCP_FASTOPEN");
+  }
+#endif
+  acceptor.bind(endpoint);
+  acceptor.listen(config.server.backlog);
+  return acceptor;
+}
+
+bool server::prewarm(const net::hosts& hosts, std::stop_token token)
+{
+  app::stopwatch stopwatch;
+  std::size_t files = 0;
+  std::uintmax_t bytes = 0;
+  std::vector<std::string> roots;
+  for (const auto& host : hosts.all()) {
+    if (std::find(roots.begin(), roots.end(), host.html) == roots.end()) {
+      roots.push_back(host.html);
+    }
+  }
+  for (const auto& root : roots) {
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator() && !token.stop_requested(); it.increment(ec))
+    {
+      if (!it->is_regular_file(ec)) {
+        continue;
+      }
+#ifndef _WIN32
+      // Let the kernel read the file ahead without copying it.
+      const auto handle = ::open(it->path().c_str(), O_RDONLY | O_CLOEXEC);
+      if (handle == -1) {
+        continue;
+      }
+      ::posix_fadvise(handle, 0, 0, POSIX_FADV_WILLNEED);
+      ::close(handle);
+#else
+      std::ifstream file{ it->path(), std::ios::binary };
+      std::array<char, 65536> buffer;
+      while (file.read(buffer.data(), buffer.size())) {
+      }
+#endif
+      files++;
+      bytes += it->file_size(ec);
+    }
+  }
+  if (token.stop_requested()) {
+    return false;
+  }
+  LOGD("[:SERVER:] Prewarmed {} files ({} bytes) in {} ms", files, bytes,
+    std::chrono::duration_cast<std::chrono::milliseconds>(stopwatch.total()).count());
+  return true;
+}
 
 auto server::operator()() noexcept -> asio::awaitable<void>
 {
   try {
+    app::stopwatch startup;
     auto executor = co_await asio::this_coro::executor;
-    auto resolver = asio::ip::tcp::resolver{ executor };
-    auto endpoint = resolver.resolve(config_.server.address, config_.server.service)->endpoint();
-    auto acceptor = asio::ip::tcp::acceptor{ asio::make_strand(executor), endpoint, true };
+    notifier_ = std::make_unique<net::notifier>(executor);
+    tracer_ = std::make_unique<net::tracer>(config_);
+    asio::co_spawn(executor, headers_->run(), asio::detached);
+    if (config_.access.filename) {
+      recorder_ = std::make_unique<net::recorder>(config_);
+    }
+    if (!config_.upstream.routes.empty()) {
+      upstream_ = std::make_unique<net::upstream>(config_, executor);
+      if (!config_.cache.routes.empty()) {
+        cache_ = std::make_unique<net::cache>(config_, executor);
+      }
+    }
+    startup.mark("services");
+    if (config_.store.filename) {
+      store_ = std::make_unique<app::store>(config_);
+      startup.mark("store");
+    }
+    auto acceptor = asio::ip::tcp::acceptor{ asio::make_strand(executor) };
+    if (listener_ == -1) {
+      acceptor = listen(config_, acceptor.get_executor());
+    } else {
+      acceptor.assign(protocol(listener_), listener_);
+    }
+    const auto endpoint = acceptor.local_endpoint();
+    startup.mark("listen");
     LOGI("[:SERVER:] Version: {}", PROJECT_VERSION);
+    LOGD("[:SERVER:] Startup: {}", startup.report());
+    if (config_.server.prewarm) {
+      prewarm_ = std::make_unique<std::jthread>([this](std::stop_token token) {
+        if (prewarm(*hosts_, token)) {
+          ready_->store(true, std::memory_order_release);
+          app::notify("READY=1");
+        }
+      });
+    } else {
+      ready_->store(true, std::memory_order_release);
+      if (listener_ == -1) {
+        app::notify("READY=1");
+      }
+    }
     if (config_.server.proxied) {
       LOGD("[:SERVER:] {}:{}", endpoint.address().to_string(), endpoint.port());
     } else {
       LOGD("[:SERVER:] http://{}:{}", endpoint.address().to_string(), endpoint.port());
     }
+    acceptor.non_blocking(true);
+    options options{ config_ };
+    asio::steady_timer backoff{ executor };
+    boost::system::error_code error;
     while (true) {
+      // Wait until connections are pending and accept them until the queue is empty.
       boost::system::error_code ec;
-      auto socket = co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
-      if (ec) {
-        if (ec == asio::error::connection_reset) {
+      co_await acceptor.async_wait(asio::ip::tcp::acceptor::wait_read, asio::redirect_error(asio::use_awaitable, ec));
+      for (std::size_t i = 0; !ec && i < accept_batch; i++) {
+        asio::ip::tcp::endpoint peer;
+        auto socket = acceptor.accept(peer, ec);
+        if (ec == asio::error::would_block || ec == asio::error::try_again) {
+          ec = {};
+          break;
+        }
+        if (ec == asio::error::connection_reset || ec == asio::error::connection_aborted) {
           LOGT("[:SERVER:] {} ({})", ec.message(), ec.value());
-        } else {
+          ec = {};
+          continue;
+        }
+        if (ec) {
+          break;
+        }
+        error = {};
+        configure(socket, options);
+        net::stats::slot::add(counters().connections, 1);
+        asio::co_spawn(executor, net::session(*this, std::move(socket), peer.address()), asio::detached);
+      }
+      if (ec) {
+        // The connection stays pending, so waiting again would complete at once. Repeated errors are only traced.
+        if (ec != error) {
           LOGE("[:SERVER:] {} ({})", ec.message(), ec.value());
+          error = ec;
+        } else {
+          LOGT("[:SERVER:] {} ({})", ec.message(), ec.value());
         }
-        continue;
+        backoff.expires_after(accept_backoff);
+        co_await backoff.async_wait(asio::use_awaitable);
       }
-      asio::co_spawn(executor, net::session(*this, std::move(socket)), asio::detached);
     }
   }
   catch (const boost::system::system_error& e) {
@@ -1,35 +1,184 @@
 #pragma once
 #include <app/config.hpp>
+#include <app/store.hpp>
+#include <net/cache.hpp>
+#include <net/client.hpp>
+#include <net/hosts.hpp>
+#include <net/hub.hpp>
+#include <net/limiter.hpp>
+#include <net/notifier.hpp>
+#include <net/recorder.hpp>
+#include <net/response.hpp>
+#include <net/stats.hpp>
+#include <net/trace.hpp>
+#include <net/types.hpp>
+#include <net/upstream.hpp>
+#include <atomic>
+#include <thread>
 
 namespace net {
 
 class server {
 public:
-  server(app::config config, const std::filesystem::path& html, const std::filesystem::path& data) :
-    config_(std::move(config)), html_(html.string()), data_(data.string())
-  {}
+  // Creates a server that listens itself or, in a worker process, accepts on the inherited listener socket.
+  server(app::config config, const std::filesystem::path& html, const std::filesystem::path& data,
+    net::stats& stats, std::size_t worker = 0, int listener = -1) :
+    config_(std::move(config)), hosts_(std::make_unique<net::hosts>(config_, html, data)),
+    types_(std::make_unique<net::types>(config_)), trusted_(config_.server.trusted),
+    limiter_(std::make_unique<net::limiter>(config_)), hub_(std::make_unique<net::hub>(config_)),
+    headers_(std::make_unique<net::headers>()), errors_(std::make_unique<net::errors>(html)), stats_(&stats),
+    worker_(worker), listener_(listener)
+  {
+    if (const auto& directory = config_.upload.directory) {
+      upload_ = "/data/" + *directory + "/";
+    }
+  }
 
   auto operator()() noexcept -> asio::awaitable<void>;
 
+  // Opens, configures and binds the listener socket.
+  static asio::ip::tcp::acceptor listen(const app::config& config, const asio::any_io_executor& executor);
+
+  // Reads the html directories into the page cache. Returns false if the token was stopped.
+  static bool prewarm(const net::hosts& hosts, std::stop_token token = {});
+
+  // Returns true once the server listens and the optional cache pre-warming finished.
+  bool ready() const noexcept
+  {
+    return ready_->load(std::memory_order_acquire);
+  }
+
+  // Free list of read buffers.
+  using buffers = std::vector<beast::flat_buffer>;
+
+  // Returns a read buffer from the free list or a new one.
+  beast::flat_buffer buffer() noexcept;
+
+  // Returns the free list. Sessions keep a weak reference, because the io_context destroys detached sessions
+  // after the server on shutdown.
+  std::weak_ptr<buffers> free_list() const noexcept
+  {
+    return buffers_;
+  }
+
+  // Returns a read buffer to a free list.
+  static void recycle(buffers& buffers, beast::flat_buffer& buffer) noexcept;
+
   constexpr const app::config& config() const noexcept
   {
     return config_;
   }
 
-  const std::string_view html() const noexcept
+  const net::hosts& hosts() const noexcept
+  {
+    return *hosts_;
+  }
+
+  const net::types& types() const noexcept
+  {
+    return *types_;
+  }
+
+  const net::stats& stats() const noexcept
+  {
+    return *stats_;
+  }
+
+  // Returns the index of this worker process or 0 without workers.
+  std::size_t worker() const noexcept
+  {
+    return worker_;
+  }
+
+  // Returns the counters of this process.
+  net::stats::slot& counters() noexcept
+  {
+    return (*stats_)[worker_];
+  }
+
+  const net::networks& trusted() const noexcept
+  {
+    return trusted_;
+  }
+
+  app::store* store() noexcept
+  {
+    return store_.get();
+  }
+
+  const net::headers& headers() const noexcept
+  {
+    return *headers_;
+  }
+
+  const net::errors& errors() const noexcept
+  {
+    return *errors_;
+  }
+
+  net::hub& hub() noexcept
+  {
+    return *hub_;
+  }
+
+  net::limiter& limiter() noexcept
+  {
+    return *limiter_;
+  }
+
+  // Returns the target prefix for uploads or an empty string if uploads are disabled.
+  std::string_view upload() const noexcept
+  {
+    return upload_;
+  }
+
+  net::notifier& notifier() noexcept
+  {
+    return *notifier_;
+  }
+
+  net::recorder* recorder() noexcept
+  {
+    return recorder_.get();
+  }
+
+  net::upstream* upstream() noexcept
+  {
+    return upstream_.get();
+  }
+
+  net::cache* cache() noexcept
   {
-    return html_;
+    return cache_.get();
   }
 
-  const std::string_view data() const noexcept
+  net::tracer& tracer() noexcept
   {
-    return data_;
+    return *tracer_;
   }
 
 private:
   app::config config_;
-  std::string html_;
-  std::string data_;
+  std::unique_ptr<net::hosts> hosts_;
+  std::unique_ptr<net::types> types_;
+  std::string upload_;
+  net::networks trusted_;
+  std::unique_ptr<net::limiter> limiter_;
+  std::unique_ptr<net::hub> hub_;
+  std::unique_ptr<net::headers> headers_;
+  std::unique_ptr<net::errors> errors_;
+  std::unique_ptr<app::store> store_;
+  std::unique_ptr<net::notifier> notifier_;
+  std::unique_ptr<net::tracer> tracer_;
+  std::unique_ptr<net::recorder> recorder_;
+  std::unique_ptr<net::upstream> upstream_;
+  std::unique_ptr<net::cache> cache_;
+  std::shared_ptr<buffers> buffers_ = std::make_shared<buffers>();
+  std::unique_ptr<std::atomic<bool>> ready_ = std::make_unique<std::atomic<bool>>(false);
+  std::unique_ptr<std::jthread> prewarm_;
+  net::stats* stats_ = nullptr;
+  std::size_t worker_ = 0;
+  int listener_ = -1;
 };
 
 }  // namespace net
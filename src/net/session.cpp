@@ -1,39 +1,151 @@
 #include "session.hpp"
-#include <version.h>
+#include <net/stream.hpp>
+#include <limits>
 
-#define SERVER_VERSION_STRING PROJECT_NAME "/" PROJECT_VERSION
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 namespace net {
 namespace {
 
-constexpr std::string_view mime_type(std::string_view path) noexcept
+// Time limit for reading a request and for every write of a long response.
+constexpr std::chrono::seconds io_timeout{ 30 };
+
+// Hub channel for changes to the key-value store.
+constexpr std::string_view store_channel = "kv";
+
+// Returns a JSON response.
+net::response json_response(const net::headers& headers, const http::request<http::string_body>& request,
+  http::status status, const json::object& object)
+{
+  net::response response{ headers, status, request.version(), request.keep_alive(), "application/json" };
+  response.body(json::to_string(object));
+  return response;
+}
+
+// Returns true if an Accept-Encoding field value accepts gzip.
+bool accepts_gzip(std::string_view value)
+{
+  for (const auto& [name, params] : http::ext_list{ value }) {
+    if (!beast::iequals(name, "gzip")) {
+      continue;
+    }
+    for (const auto& [key, quality] : params) {
+      if (key == "q") {
+        return quality.find_first_not_of("0.") != std::string_view::npos;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+// Returns true if the target is the prefix or a channel below it, like "/ws" or "/ws/chat".
+bool is_channel(std::string_view target, std::string_view prefix) noexcept
+{
+  return target.starts_with(prefix) && (target.size() == prefix.size() || target[prefix.size()] == '/');
+}
+
+// Removes hop-by-hop fields, including the ones listed in the Connection field.
+template <bool isRequest, typename Fields>
+void strip(http::header<isRequest, Fields>& header)
+{
+  std::vector<std::string> names;
+  for (const auto token : http::token_list{ header[http::field::connection] }) {
+    names.emplace_back(token);
+  }
+  for (const auto& name : names) {
+    header.erase(name);
+  }
+  for (const auto field : { http::field::connection, http::field::keep_alive, http::field::proxy_authenticate,
+         http::field::proxy_authorization, http::field::proxy_connection, http::field::te, http::field::trailer,
+         http::field::upgrade })
+  {
+    header.erase(field);
+  }
+}
+
+// Prepares a request to be forwarded to a backend over HTTP/1.1.
+template <typename Body>
+void forward(http::request<Body>& message, const asio::ip::address& client)
 {
-  // clang-format off
-  if (const auto i = path.rfind('.'); i != std::string_view::npos) {
-    const auto ext = path.substr(i + 1);
-    if (ext == "js")   return "application/javascript";
-    if (ext == "json") return "application/json";
-    if (ext == "map")  return "application/json";
-    if (ext == "txt")  return "text/plain";
-    if (ext == "html") return "text/html";
-    if (ext == "css")  return "text/css";
-    if (ext == "gif")  return "image/gif";
-    if (ext == "jpeg") return "image/jpeg";
-    if (ext == "jpg")  return "image/jpeg";
-    if (ext == "png")  return "image/png";
-    if (ext == "svg")  return "image/svg+xml";
-    if (ext == "ico")  return "image/x-icon";
-    if (ext == "ttf")  return "font/ttf";
-  }
-  // clang-format on
-  return "application/octet-stream";
+  strip(message);
+  message.version(11);
+  message.keep_alive(true);
+  auto forwarded = client.to_string();
+  if (const auto it = message.find("X-Forwarded-For"); it != message.end()) {
+    forwarded = fmt::format("{}, {}", it->value(), forwarded);
+  }
+  message.set("X-Forwarded-For", forwarded);
+}
+
+// Relays a message whose header was read to the output without buffering the body.
+// The deadline of a stream is renewed before every read and write. Adds the number of bytes written to the output
+// to size. Returns true if the error came from the input.
+template <bool isRequest>
+auto relay(beast::tcp_stream& output, beast::tcp_stream& input, beast::flat_buffer& buffer,
+  http::parser<isRequest, http::buffer_body>& parser, std::chrono::milliseconds timeout, std::uint64_t& size,
+  beast::error_code& ec) -> asio::awaitable<bool>
+{
+  std::array<char, 16384> chunk;
+  auto& body = parser.get().body();
+  body.data = nullptr;
+  body.size = 0;
+  body.more = !parser.is_done();
+  http::serializer<isRequest, http::buffer_body> serializer{ parser.get() };
+  output.expires_after(timeout);
+  size += co_await http::async_write_header(output, serializer, asio::redirect_error(asio::use_awaitable, ec));
+  if (ec) {
+    co_return false;
+  }
+  while (!serializer.is_done()) {
+    if (!parser.is_done()) {
+      body.data = chunk.data();
+      body.size = chunk.size();
+      input.expires_after(timeout);
+      co_await http::async_read(input, buffer, parser, asio::redirect_error(asio::use_awaitable, ec));
+      if (ec == http::error::need_buffer) {
+        ec = {};
+      }
+      if (ec) {
+        co_return true;
+      }
+      body.size = chunk.size() - body.size;
+      body.data = chunk.data();
+      body.more = !parser.is_done();
+    } else {
+      body.data = nullptr;
+      body.size = 0;
+      body.more = false;
+    }
+    output.expires_after(timeout);
+    size += co_await http::async_write(output, serializer, asio::redirect_error(asio::use_awaitable, ec));
+    if (ec == http::error::need_buffer) {
+      ec = {};
+    }
+    if (ec) {
+      co_return false;
+    }
+  }
+  co_return false;
 }
 
 }  // namespace
 
-session::session(net::server& server, asio::ip::tcp::socket socket) : server_(server), stream_(std::move(socket))
+session::session(net::server& server, asio::ip::tcp::socket socket, const asio::ip::address& address) :
+  server_(server), stream_(std::move(socket)), buffer_(server.buffer()), buffers_(server.free_list()),
+  client_(address), connection_(server.tracer().connection())
 {
-  stream_.expires_after(std::chrono::seconds(30));
+  trace_.mark(net::phase::accepted);
+  stream_.expires_after(io_timeout);
+}
+
+session::~session()
+{
+  if (const auto buffers = buffers_.lock()) {
+    net::server::recycle(*buffers, buffer_);
+  }
 }
 
 bool session::close_on_error(beast::error_code& ec, const char* what)
@@ -48,50 +160,71 @@ bool session::close_on_error(beast::error_code& ec, const char* what)
   return true;
 }
 
+void session::resolve(const http::request<http::string_body>& request) noexcept
+{
+  // The host of a request that came through a reverse proxy is in the X-Forwarded-Host field.
+  auto it = request.end();
+  if (server_.config().server.proxied) {
+    it = request.find("X-Forwarded-Host");
+  }
+  if (it == request.end()) {
+    it = request.find(http::field::host);
+  }
+  auto name = it != request.end() ? it->value() : std::string_view{};
+  host_ = &server_.hosts().find(name.substr(0, name.find(',')));
+}
+
+void session::finish(const http::request<http::string_body>& request)
+{
+  server_.counters().record(status_, bytes_);
+  auto& tracer = server_.tracer();
+  tracer.finish(trace_, connection_, client_, status_, request.method_string(), request.target());
+  if (const auto recorder = server_.recorder()) {
+    const auto latency = tracer.elapsed(trace_[net::phase::received], trace_[net::phase::written]);
+    recorder->record(client_, request.method(), status_, bytes_, static_cast<std::uint64_t>(latency), request.target());
+  }
+  trace_.reset();
+  status_ = 0;
+  bytes_ = 0;
+}
+
 auto session::operator()() noexcept -> asio::awaitable<void>
 {
   try {
-    if (!server_.config().server.proxied) {
-      client(stream_.socket().remote_endpoint().address());
-    }
     beast::error_code ec;
-    beast::flat_buffer buffer;
     http::request<http::string_body> request;
-    co_await http::async_read(stream_, buffer, request, asio::redirect_error(asio::use_awaitable, ec));
-    if (close_on_error(ec)) {
-      co_return;
-    }
-    if (server_.config().server.proxied) {
-      const auto it = request.find("X-Real-IP");
-      if (it == request.end()) {
-        http::response<http::string_body> response{ http::status::use_proxy, request.version() };
-        response.set(http::field::server, SERVER_VERSION_STRING);
-        response.set(http::field::content_type, "text/html");
-        response.keep_alive(request.keep_alive());
-        response.body() = "<code>Reverse proxy required. See server log for details.</code>";
-        response.prepare_payload();
-        LOGE("[{::^8}] Reverse proxy missing header: 'X-Real-IP'", client_);
-        co_await http::async_write(stream_, response, asio::redirect_error(asio::use_awaitable, ec));
-        stream_.socket().shutdown(asio::ip::tcp::socket::shutdown_send, ec);
+    const auto peer = client_;
+    do {
+      co_await read(request, ec);
+      if (close_on_error(ec)) {
         co_return;
       }
-      client(asio::ip::address::from_string(std::string{ it->value() }));
-    }
-    co_await handle(request, ec);
-    if (close_on_error(ec)) {
-      co_return;
-    }
-    while (request.version() > 10) {
-      request.clear();
-      co_await http::async_read(stream_, buffer, request, asio::redirect_error(asio::use_awaitable, ec));
-      if (close_on_error(ec)) {
+
+      // Every request is checked, because keep-alive requests can address a different virtual host.
+      resolve(request);
+      client_ = peer;
+      if (host_->proxied) {
+        const auto forwarded = request.find("X-Forwarded-For");
+        const auto it = forwarded != request.end() ? forwarded : request.find("X-Real-IP");
+        if (it == request.end()) {
+          const auto response =
+            server_.errors()(server_.headers(), http::status::use_proxy, request.version(), request.keep_alive());
+          LOGE("[{::^8}] Reverse proxy missing header: 'X-Forwarded-For' or 'X-Real-IP'", client_);
+          co_await write(response);
+          stream_.socket().shutdown(asio::ip::tcp::socket::shutdown_send, ec);
+          co_return;
+        }
+        client_ = net::forwarded(it->value(), peer, server_.trusted());
+      }
+      if (websocket::is_upgrade(request) && is_channel(request.target(), "/ws")) {
+        co_await upgrade(request);
         co_return;
       }
-      co_await handle(request, ec);
+      co_await serve(request, ec);
       if (close_on_error(ec)) {
         co_return;
       }
-    }
+    } while (request.version() > 10);
   }
   catch (const boost::system::system_error& e) {
     if (auto ec = e.code(); ec != beast::error::timeout && ec != http::error::end_of_stream) {
@@ -109,128 +242,807 @@ auto session::operator()() noexcept -> asio::awaitable<void>
   co_return;
 }
 
-auto session::handle(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
+auto session::serve(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
 {
-  // Returns a bad request response.
-  const auto bad_request = [&request](beast::string_view why) {
-    http::response<http::string_body> response{ http::status::bad_request, request.version() };
-    response.set(http::field::server, SERVER_VERSION_STRING);
-    response.set(http::field::content_type, "text/html");
-    response.keep_alive(request.keep_alive());
-    response.body() = "<code>" + std::string(why) + "</code>";
-    response.prepare_payload();
-    return response;
+  try {
+    co_await handle(request, ec);
+  }
+  catch (const boost::system::system_error& e) {
+    if (e.code() != http::error::end_of_stream) {
+      throw;
+    }
+    ec = e.code();
+  }
+  if (pending_ && !ec) {
+    // The body of the request was not read.
+    ec = http::error::end_of_stream;
+  }
+  pending_.reset();
+  if (!ec || ec == http::error::end_of_stream) {
+    finish(request);
+  }
+}
+
+auto session::write(const net::response& response) -> asio::awaitable<void>
+{
+  trace_.mark(net::phase::handled);
+  status_ = static_cast<unsigned>(response.result());
+  bytes_ += co_await asio::async_write(stream_, response.buffers(), asio::use_awaitable);
+  trace_.mark(net::phase::written);
+  if (!response.keep_alive()) {
+    throw boost::system::system_error(http::error::end_of_stream);
+  }
+}
+
+auto session::pace(const net::response& response, beast::file& file, std::uint64_t size,
+  const net::limiter::route& route) -> asio::awaitable<void>
+{
+  trace_.mark(net::phase::handled);
+  status_ = static_cast<unsigned>(response.result());
+  stream_.expires_after(io_timeout);
+  bytes_ += co_await asio::async_write(stream_, response.buffers(), asio::use_awaitable);
+  auto& limiter = server_.limiter();
+  asio::steady_timer timer{ co_await asio::this_coro::executor };
+  std::array<char, 16384> chunk;
+  for (std::uint64_t offset = 0; offset < size;) {
+    beast::error_code ec;
+    const auto limit = static_cast<std::size_t>(std::min<std::uint64_t>(chunk.size(), size - offset));
+    const auto count = file.read(chunk.data(), limit, ec);
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+    if (count == 0) {
+      // The file was truncated and the promised length cannot be sent.
+      throw boost::system::system_error(asio::error::eof);
+    }
+    // A throttled body can take longer than the deadline, so every chunk gets its own.
+    stream_.expires_after(io_timeout);
+    bytes_ += co_await asio::async_write(stream_, asio::buffer(chunk.data(), count), asio::use_awaitable);
+    offset += count;
+    if (const auto delay = limiter.charge(client_, route, count); delay.count() > 0) {
+      timer.expires_after(delay);
+      co_await timer.async_wait(asio::use_awaitable);
+    }
+  }
+  trace_.mark(net::phase::written);
+  if (!response.keep_alive()) {
+    throw boost::system::system_error(http::error::end_of_stream);
+  }
+}
+
+auto session::send(const net::response& response, beast::file& file, std::uint64_t size) -> asio::awaitable<void>
+{
+  trace_.mark(net::phase::handled);
+  status_ = static_cast<unsigned>(response.result());
+  bytes_ += co_await asio::async_write(stream_, response.buffers(), asio::use_awaitable);
+#ifdef __linux__
+  // The stream only applies its timeout to its own operations, so a timer cancels the wait for a stalled client.
+  auto& socket = stream_.socket();
+  socket.native_non_blocking(true);
+  asio::steady_timer timer{ socket.get_executor() };
+  const auto alive = std::make_shared<bool>();
+  off_t offset = 0;
+  while (static_cast<std::uint64_t>(offset) < size) {
+    const auto count = static_cast<std::size_t>(size - static_cast<std::uint64_t>(offset));
+    const auto result = ::sendfile(socket.native_handle(), file.native_handle(), &offset, count);
+    if (result > 0) {
+      bytes_ += static_cast<std::uint64_t>(result);
+      continue;
+    }
+    if (result == 0) {
+      // The file was truncated and the promised length cannot be sent.
+      throw boost::system::system_error(asio::error::eof);
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN) {
+      throw boost::system::system_error(errno, boost::system::system_category());
+    }
+    timer.expires_after(io_timeout);
+    timer.async_wait([&socket, alive = std::weak_ptr{ alive }](const boost::system::error_code& ec) {
+      if (!ec && !alive.expired()) {
+        socket.cancel();
+      }
+    });
+    boost::system::error_code ec;
+    co_await socket.async_wait(asio::ip::tcp::socket::wait_write, asio::redirect_error(asio::use_awaitable, ec));
+    timer.cancel();
+    if (ec == asio::error::operation_aborted) {
+      throw boost::system::system_error(beast::error::timeout);
+    }
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+  }
+#else
+  throw std::runtime_error("Sendfile is not supported on this platform.");
+#endif
+  trace_.mark(net::phase::written);
+  if (!response.keep_alive()) {
+    throw boost::system::system_error(http::error::end_of_stream);
+  }
+}
+
+auto session::read(http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
+{
+  // Read the header without consuming the body.
+  pending_ = std::make_unique<http::request_parser<http::empty_body>>();
+  auto& header = *pending_;
+  co_await http::async_read_some(stream_, buffer_, header, asio::redirect_error(asio::use_awaitable, ec));
+  trace_.mark(net::phase::received);
+  if (!ec && !header.is_header_done()) {
+    co_await http::async_read_header(stream_, buffer_, header, asio::redirect_error(asio::use_awaitable, ec));
+  }
+  trace_.mark(net::phase::parsed);
+  if (ec) {
+    pending_.reset();
+    co_return;
+  }
+
+  // Uploads are streamed to a file by upload() and proxied requests to a backend by proxy().
+  const auto method = header.get().method();
+  const auto prefix = server_.upload();
+  const auto upstream = server_.upstream();
+  if (((method == http::verb::put || method == http::verb::post) && !prefix.empty() &&
+        header.get().target().starts_with(prefix)) ||
+    (upstream && upstream->match(header.get().target())))
+  {
+    request = {};
+    request.base() = header.get().base();
+    co_return;
+  }
+
+  http::request_parser<http::string_body> parser{ std::move(header) };
+  pending_.reset();
+  if (!parser.is_done()) {
+    co_await http::async_read(stream_, buffer_, parser, asio::redirect_error(asio::use_awaitable, ec));
+  }
+  if (!ec) {
+    request = parser.release();
+  }
+}
+
+auto session::upload(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
+{
+  const auto& config = server_.config().upload;
+  const auto& headers = server_.headers();
+
+  // Reject uploads that are too large before the body is sent.
+  if (const auto size = pending_->content_length(); size && *size > config.size) {
+    auto response = json_response(headers, request, http::status::payload_too_large, { { "success", false } });
+    response.keep_alive(false);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+  if (request.target().back() == '/') {
+    auto response = json_response(headers, request, http::status::bad_request, { { "success", false } });
+    response.keep_alive(false);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+
+  // Stream the body into a temporary file next to the destination. Connection ids are only unique per worker.
+  const auto file = std::filesystem::path(host_->data + std::string(request.target().substr(5)));
+  auto temp = file;
+  temp += fmt::format(".{}-{}.tmp", server_.worker(), connection_);
+  http::request_parser<http::file_body> parser{ std::move(*pending_) };
+  pending_.reset();
+  parser.body_limit(config.size);
+  std::error_code error;
+  std::filesystem::create_directories(file.parent_path(), error);
+  parser.get().body().open(temp.string().data(), beast::file_mode::write, ec);
+  if (ec) {
+    auto response = json_response(headers, request, http::status::internal_server_error, { { "success", false } });
+    response.keep_alive(false);
+    LOGW("[{::^8}] {:03d} {} {} ({})", client_, response.result(), request.method_string(), request.target(), ec.message());
+    co_await write(response);
+    ec = {};
+    co_return;
+  }
+  if (beast::iequals(request[http::field::expect], "100-continue")) {
+    http::response<http::empty_body> response{ http::status::continue_, request.version() };
+    co_await http::async_write(stream_, response, asio::use_awaitable);
+  }
+  co_await http::async_read(stream_, buffer_, parser, asio::redirect_error(asio::use_awaitable, ec));
+  parser.get().body().close();
+  if (ec) {
+    std::filesystem::remove(temp, error);
+    if (ec != http::error::body_limit) {
+      co_return;
+    }
+    auto response = json_response(headers, request, http::status::payload_too_large, { { "success", false } });
+    response.keep_alive(false);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    ec = http::error::end_of_stream;
+    co_return;
+  }
+
+  // Replace the destination atomically.
+  const auto exists = std::filesystem::exists(file, error);
+  std::filesystem::rename(temp, file, error);
+  if (error) {
+    std::filesystem::remove(temp, error);
+    auto response = json_response(headers, request, http::status::internal_server_error, { { "success", false } });
+    LOGW("[{::^8}] {:03d} {} {} ({})", client_, response.result(), request.method_string(), request.target(), error.message());
+    co_await write(response);
+    co_return;
+  }
+  const auto status = exists ? http::status::ok : http::status::created;
+  auto response = json_response(headers, request, status, { { "success", true } });
+  LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+  co_await write(response);
+}
+
+auto session::proxy(const http::request<http::string_body>& request, net::upstream::route& route,
+  beast::error_code& ec) -> asio::awaitable<void>
+{
+  auto& upstream = *server_.upstream();
+  const auto& headers = server_.headers();
+  const auto version = request.version();
+  const auto keep_alive = request.keep_alive();
+
+  // Serve requests without a body on cached routes from the micro-cache.
+  if (const auto cache = server_.cache(); cache && request.method() == http::verb::get && pending_->is_done()) {
+    if (const auto rule = cache->match(request.target())) {
+      if (co_await cached(request, route, *rule)) {
+        co_return;
+      }
+    }
+  }
+
+  // Forward the request over HTTP/1.1 with the client address and without hop-by-hop fields.
+  // The expectation of a request body is answered here, so that the backend sends no interim response.
+  http::request_parser<http::buffer_body> input{ std::move(*pending_) };
+  pending_.reset();
+  // Boost 1.74 compares a Content-Length with a disabled limit as exceeding it, so the limit is set to the maximum.
+  input.body_limit(std::numeric_limits<std::uint64_t>::max());
+  const auto expect = beast::iequals(input.get()[http::field::expect], "100-continue") && !input.is_done();
+  input.get().erase(http::field::expect);
+  forward(input.get(), client_.address());
+
+  // A request without a body can be sent again when a pooled connection was closed by the backend.
+  // Requests with a body use a new connection.
+  const auto retry = input.is_done();
+  const auto timeout = upstream.timeout();
+  net::upstream::connection connection;
+  std::optional<http::response_parser<http::buffer_body>> output;
+  for (std::size_t attempt = 0; true; attempt++) {
+    connection = co_await upstream.connect(route, retry);
+    if (!connection.stream) {
+      const auto response = server_.errors()(headers, http::status::bad_gateway, version, keep_alive && retry);
+      LOGW("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+      co_await write(response);
+      co_return;
+    }
+    if (expect) {
+      http::response<http::empty_body> response{ http::status::continue_, version };
+      co_await http::async_write(stream_, response, asio::redirect_error(asio::use_awaitable, ec));
+      if (ec) {
+        upstream.release(connection, false);
+        co_return;
+      }
+    }
+    const auto reused = connection.reused;
+    std::uint64_t sent = 0;
+    if (co_await relay(*connection.stream, stream_, buffer_, input, timeout, sent, ec)) {
+      upstream.release(connection, false);
+      co_return;
+    }
+
+    // Skip interim responses other than protocol switches, which are not relayed without the Upgrade field.
+    while (!ec) {
+      output.emplace();
+      output->body_limit(std::numeric_limits<std::uint64_t>::max());
+      output->skip(request.method() == http::verb::head);
+      connection.stream->expires_after(timeout);
+      co_await http::async_read_header(*connection.stream, connection.buffer, *output,
+        asio::redirect_error(asio::use_awaitable, ec));
+      if (ec || output->get().result_int() >= 200 || output->get().result() == http::status::switching_protocols) {
+        break;
+      }
+    }
+    if (!ec) {
+      break;
+    }
+    if (reused && retry && attempt == 0) {
+      upstream.release(connection, false);
+      ec = {};
+      continue;
+    }
+    const auto status = ec == beast::error::timeout ? http::status::gateway_timeout : http::status::bad_gateway;
+    LOGW("[UPSTREAM] {}: {} ({})", connection.origin->name, ec.message(), ec.value());
+    upstream.fail(connection);
+    ec = {};
+    const auto response = server_.errors()(headers, status, version, keep_alive && retry);
+    LOGW("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+
+  // Relay the response in the version of the client.
+  // A body that ends when the backend closes the connection is chunked for HTTP/1.1 clients and ends with the
+  // client connection for HTTP/1.0 clients.
+  auto& response = output->get();
+  const auto reusable = output->keep_alive();
+  strip(response);
+  response.version(version);
+  if (version < 11 && (response.chunked() || output->need_eof())) {
+    response.chunked(false);
+    response.keep_alive(false);
+  } else {
+    if (output->need_eof()) {
+      response.chunked(true);
+    }
+    response.keep_alive(keep_alive);
+  }
+  trace_.mark(net::phase::handled);
+  status_ = response.result_int();
+  LOGI("[{::^8}] {:03d} {} {}", client_, response.result_int(), request.method_string(), request.target());
+  if (co_await relay(stream_, *connection.stream, connection.buffer, *output, timeout, bytes_, ec)) {
+    LOGW("[UPSTREAM] {}: {} ({})", connection.origin->name, ec.message(), ec.value());
+    upstream.fail(connection);
+    co_return;
+  }
+  trace_.mark(net::phase::written);
+  upstream.release(connection, output->is_done() && reusable && connection.buffer.size() == 0);
+  if (!ec && !response.keep_alive()) {
+    ec = http::error::end_of_stream;
+  }
+}
+
+auto session::cached(const http::request<http::string_body>& request, net::upstream::route& route,
+  const net::cache::route& rule) -> asio::awaitable<bool>
+{
+  auto& upstream = *server_.upstream();
+  http::request<http::empty_body> message{ request.base() };
+  forward(message, client_.address());
+
+  // Concurrent misses share one backend request.
+  using result = std::shared_ptr<const net::cache::response>;
+  const auto limit = server_.config().cache.entry;
+  net::cache::producer produce = [&upstream, &route, message = std::move(message), limit]() -> asio::awaitable<result> {
+    auto response = co_await upstream.fetch(route, message, limit);
+    if (response) {
+      strip(*response);
+      response->version(11);
+      response->keep_alive(true);
+      response->prepare_payload();
+    }
+    co_return response;
   };
+  // GCC destroys temporaries in co_await expressions twice, so the producer is passed from a variable.
+  auto get = server_.cache()->get(request, rule, std::move(produce));
+  const auto value = co_await std::move(get);
+  if (!value) {
+    co_return false;
+  }
+  pending_.reset();
+
+  // The serialized response is written as is to HTTP/1.1 keep-alive connections.
+  const auto& response = *value->message;
+  LOGI("[{::^8}] {:03d} {} {}", client_, response.result_int(), request.method_string(), request.target());
+  if (request.version() == 11 && request.keep_alive()) {
+    trace_.mark(net::phase::handled);
+    status_ = response.result_int();
+    bytes_ += co_await asio::async_write(stream_, asio::buffer(value->serialized), asio::use_awaitable);
+    trace_.mark(net::phase::written);
+    co_return true;
+  }
+  auto copy = response;
+  copy.version(request.version());
+  copy.keep_alive(request.keep_alive());
+  co_await write(copy);
+  co_return true;
+}
 
-  // Returns a not found response.
-  const auto not_found = [&request](beast::string_view target) {
-    http::response<http::string_body> response{ http::status::not_found, request.version() };
+auto session::upgrade(const http::request<http::string_body>& request) -> asio::awaitable<void>
+{
+  auto executor = co_await asio::this_coro::executor;
+  auto channel = std::string(request.target().substr(3));
+  if (!channel.empty() && channel[0] == '/') {
+    channel.erase(0, 1);
+  }
+
+  // Accept the WebSocket handshake.
+  const auto ws = std::make_shared<websocket::stream<beast::tcp_stream>>(std::move(stream_));
+  ws->next_layer().expires_never();
+  ws->set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+  ws->set_option(websocket::stream_base::decorator([](websocket::response_type& response) {
     response.set(http::field::server, SERVER_VERSION_STRING);
-    response.set(http::field::content_type, "text/html");
-    response.keep_alive(request.keep_alive());
-    response.body() = "<code>The resource '" + std::string(target) + "' was not found.</code>";
-    response.prepare_payload();
-    return response;
+  }));
+  co_await ws->async_accept(request, asio::use_awaitable);
+  ws->text(true);
+  LOGI("[{::^8}] 101 {} {}", client_, request.method_string(), request.target());
+
+  // Write queued messages. Closing the socket aborts the read loop below.
+  auto& hub = server_.hub();
+  const auto subscriber = hub.subscribe(std::move(channel), executor);
+  asio::co_spawn(executor, [ws, subscriber, client = client_]() -> asio::awaitable<void> {
+    boost::system::error_code ec;
+    while (const auto message = co_await subscriber->pop()) {
+      co_await ws->async_write(asio::buffer(*message), asio::redirect_error(asio::use_awaitable, ec));
+      if (ec) {
+        break;
+      }
+    }
+    if (subscriber->evicted()) {
+      LOGW("[{::^8}] WebSocket subscriber evicted", client);
+    }
+    beast::get_lowest_layer(*ws).socket().close(ec);
+  }, asio::detached);
+
+  // Read messages until the connection is closed.
+  beast::error_code ec;
+  beast::flat_buffer buffer;
+  const auto publish = server_.config().websocket.publish;
+  while (true) {
+    co_await ws->async_read(buffer, asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      break;
+    }
+    if (publish) {
+      hub.publish(subscriber->channel(), beast::buffers_to_string(buffer.data()));
+    }
+    buffer.consume(buffer.size());
+  }
+  hub.unsubscribe(subscriber);
+  if (ec != websocket::error::closed && ec != asio::error::operation_aborted && ec != asio::error::bad_descriptor) {
+    LOGD("[{::^8}] {}: {} ({})", client_, ec.category().name(), ec.message(), ec.value());
+  }
+}
+
+auto session::events(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
+{
+  auto executor = co_await asio::this_coro::executor;
+  auto channel = std::string(request.target().substr(7));
+  if (!channel.empty() && channel[0] == '/') {
+    channel.erase(0, 1);
+  }
+
+  // Write the header. A HEAD request does not subscribe.
+  net::stream stream{ stream_, http::status::ok, request.version(), "text/event-stream" };
+  stream.response().set(http::field::server, SERVER_VERSION_STRING);
+  stream.response().set(http::field::date, server_.headers().date_value());
+  LOGI("[{::^8}] {:03d} {} {}", client_, stream.response().result(), request.method_string(), request.target());
+  if (request.method() == http::verb::head) {
+    // The header has no length, so the connection is closed after it like after a stream.
+    http::response<http::empty_body> response{ stream.response().base() };
+    response.chunked(false);
+    response.keep_alive(false);
+    co_await write(response);
+    co_return;
+  }
+  stream_.expires_never();
+  trace_.mark(net::phase::handled);
+  status_ = stream.response().result_int();
+  co_await stream.begin(ec);
+  if (ec) {
+    co_return;
+  }
+
+  // Close the subscriber when the client sends data or closes the connection.
+  auto& hub = server_.hub();
+  const auto subscriber = hub.subscribe(std::move(channel), executor);
+  asio::co_spawn(executor, [&socket = stream_.socket(), subscriber]() -> asio::awaitable<void> {
+    boost::system::error_code ec;
+    co_await socket.async_wait(asio::ip::tcp::socket::wait_read, asio::redirect_error(asio::use_awaitable, ec));
+    subscriber->close();
+  }, asio::detached);
+
+  // Write events as they are published.
+  while (const auto message = co_await subscriber->pop()) {
+    co_await stream.event(*message, {}, ec);
+    if (ec) {
+      break;
+    }
+  }
+  hub.unsubscribe(subscriber);
+  if (subscriber->evicted()) {
+    LOGW("[{::^8}] Event stream subscriber evicted", client_);
+  }
+  if (!ec) {
+    co_await stream.end(ec);
+  }
+  trace_.mark(net::phase::written);
+
+  // The stream can not be followed by another request.
+  if (!ec) {
+    ec = http::error::end_of_stream;
+  }
+}
+
+auto session::store(const http::request<http::string_body>& request) -> asio::awaitable<void>
+{
+  const auto& headers = server_.headers();
+  const auto reply = [&headers, &request](http::status status, const json::object& object) {
+    return json_response(headers, request, status, object);
   };
 
-  // Returns a server error response.
-  const auto server_error = [&request](beast::string_view what) {
-    http::response<http::string_body> response{ http::status::internal_server_error, request.version() };
+  const auto key = request.target().substr(9);
+  auto store = server_.store();
+  if (!store || key.empty() || key.size() > 1024) {
+    auto response = store ? reply(http::status::bad_request, { { "success", false }, { "error", "Invalid key" } })
+                          : reply(http::status::not_found, { { "success", false }, { "error", "Store disabled" } });
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+
+  // Reject values that are not JSON before they are stored.
+  json::value parsed;
+  if (request.method() == http::verb::put) {
+    if (beast::error_code ec; parsed = json::parse(request.body(), ec), ec) {
+      auto response = reply(http::status::bad_request, { { "success", false }, { "error", ec.message() } });
+      LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+      co_await write(response);
+      co_return;
+    }
+  }
+
+  // Only the store operation is guarded, since a write reports a closed connection with an exception.
+  std::optional<app::store::value> value;
+  auto found = false;
+  std::string error;
+  try {
+    switch (request.method()) {
+    case http::verb::get:
+    case http::verb::head:
+      value = store->get(key);
+      found = value.has_value();
+      break;
+    case http::verb::put:
+      co_await store->put(key, request.body());
+      found = true;
+      break;
+    case http::verb::delete_:
+      found = co_await store->erase(key);
+      break;
+    default:
+      break;
+    }
+  }
+  catch (const std::exception& e) {
+    error = e.what();
+  }
+
+  // Handle a store error.
+  if (!error.empty()) {
+    auto response = reply(http::status::internal_server_error, { { "success", false }, { "error", error } });
+    LOGW("[{::^8}] {:03d} {} {} ({})", client_, response.result(), request.method_string(), request.target(), error);
+    co_await write(response);
+    co_return;
+  }
+
+  // Publish changes to the subscribers of the store channel.
+  if (found && (request.method() == http::verb::put || request.method() == http::verb::delete_)) {
+    json::object change{ { "key", key } };
+    if (request.method() == http::verb::put) {
+      change["value"] = std::move(parsed);
+    }
+    server_.hub().publish(store_channel, json::to_string(change));
+  }
+
+  if (value) {
+    // The value is sent straight from the mapping, which is kept alive by the value.
+    http::response<http::span_body<const char>> response{
+      std::piecewise_construct,
+      std::make_tuple(value->data.data(), value->data.size()),
+      std::make_tuple(http::status::ok, request.version()),
+    };
     response.set(http::field::server, SERVER_VERSION_STRING);
-    response.set(http::field::content_type, "text/html");
+    response.set(http::field::date, server_.headers().date_value());
+    response.set(http::field::content_type, "application/json");
     response.keep_alive(request.keep_alive());
-    response.body() = "<code>An error occurred: '" + std::string(what) + "'</code>";
-    response.prepare_payload();
-    return response;
+    response.content_length(value->data.size());
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    if (request.method() == http::verb::head) {
+      http::response<http::empty_body> header{ std::move(response.base()) };
+      co_await write(header);
+    } else {
+      co_await write(response);
+    }
+    co_return;
+  }
+
+  auto response = found ? reply(http::status::ok, { { "success", true } })
+                        : reply(http::status::not_found, { { "success", false } });
+  LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+  co_await write(response);
+}
+
+auto session::handle(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>
+{
+  const auto& headers = server_.headers();
+
+  // Returns a pre-rendered error response.
+  const auto error = [this, &headers, &request](http::status status) {
+    return server_.errors()(headers, status, request.version(), request.keep_alive());
   };
 
   // Make sure we can handle the method.
-  if (request.method() != http::verb::get && request.method() != http::verb::head) {
-    const auto response = bad_request("Unknown HTTP-method");
+  const auto method = request.method();
+  const auto writable = request.target().starts_with("/rest/kv/");
+  if (method != http::verb::get && method != http::verb::head && !pending_ &&
+    !(writable && (method == http::verb::put || method == http::verb::delete_)))
+  {
+    const auto response = error(http::status::bad_request);
     LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    co_await write(response);
     co_return;
   }
 
   // Request path must be absolute and not contain "..".
   if (request.target().empty() || request.target()[0] != '/' || request.target().find("..") != beast::string_view::npos) {
-    const auto response = bad_request("Illegal request-target");
+    const auto response = error(http::status::bad_request);
     LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    co_await write(response);
+    co_return;
+  }
+
+  // Enforce per-client rate limits.
+  auto& limiter = server_.limiter();
+  const auto route = limiter.match(request.target());
+  if (route && !limiter.acquire(client_, *route)) {
+    const auto response = error(http::status::too_many_requests);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+
+  if (pending_) {
+    if (const auto upstream = server_.upstream()) {
+      if (const auto route = upstream->match(request.target())) {
+        co_await proxy(request, *route, ec);
+        co_return;
+      }
+    }
+    co_await upload(request, ec);
+    co_return;
+  }
+
+  if (is_channel(request.target(), "/events")) {
+    co_await events(request, ec);
+    co_return;
+  }
+
+  if (request.target().starts_with("/rest/kv/")) {
+    co_await store(request);
+    co_return;
+  }
+
+  if (request.target() == "/healthz" || request.target() == "/readyz") {
+    const auto ready = request.target() == "/healthz" || server_.ready();
+    const auto status = ready ? http::status::ok : http::status::service_unavailable;
+    const auto response = json_response(headers, request, status, { { "success", ready } });
+    LOGD("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
+    co_return;
+  }
+
+  if (request.target() == "/stats") {
+    auto object = server_.stats().report();
+    object["workers"] = server_.config().server.workers;
+    const auto response = json_response(headers, request, http::status::ok, object);
+    LOGD("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await write(response);
     co_return;
   }
 
   if (request.target() == "/rest") {
-    http::response<http::string_body> response{ http::status::ok, request.version() };
-    response.set(http::field::server, SERVER_VERSION_STRING);
-    response.set(http::field::content_type, "application/json");
-    response.keep_alive(request.keep_alive());
-    response.body() = json::to_string(json::object{ { "success", true } });
-    response.prepare_payload();
+    const auto response = json_response(headers, request, http::status::ok, { { "success", true } });
     LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    co_await write(response);
     co_return;
   }
 
   // Build file path.
-  const auto data = server_.data();
-  const auto html = server_.html();
   std::string file;
   if (request.target().starts_with("/data/")) {
-    file.append(server_.data());
+    file.append(host_->data);
     file.append(request.target().substr(5));
   } else {
-    file.append(server_.html());
+    file.append(host_->html);
     file.append(request.target());
   }
   if (request.target().back() == '/') {
     file.append("index.html");
   }
 
-  // Attempt to open the file.
+  // Attempt to open a precompressed file for clients that accept it, then the file itself.
+  const auto& type = server_.types().find(file);
+  const auto& mime = server_.config().mime;
+  const auto negotiate = mime.precompressed && type.compress;
+  auto gzip = negotiate && accepts_gzip(request[http::field::accept_encoding]);
   http::file_body::value_type body;
-  body.open(file.data(), beast::file_mode::scan, ec);
+  if (gzip) {
+    file.append(".gz");
+    body.open(file.data(), beast::file_mode::scan, ec);
+    file.resize(file.size() - 3);
+    gzip = !ec;
+  }
+  if (!gzip) {
+    body.open(file.data(), beast::file_mode::scan, ec);
+  }
   if (ec && ec == beast::errc::permission_denied) {
-    auto executor = co_await asio::this_coro::executor;
-    auto timer = asio::system_timer{ executor };
-    for (std::size_t i = 0; ec && ec == beast::errc::permission_denied && i < 500; i++) {
-      timer.expires_after(std::chrono::milliseconds{ 20 });
-      co_await timer.async_wait(asio::use_awaitable);
+    auto& notifier = server_.notifier();
+    const auto start = net::notifier::clock::now();
+    const auto deadline = start + server_.config().server.wait;
+    while (ec == beast::errc::permission_denied && co_await notifier.wait(file, deadline)) {
       body.open(file.data(), beast::file_mode::scan, ec);
     }
+    const auto duration = net::notifier::clock::now() - start;
+    server_.counters().wait(
+      static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()), !ec);
+    LOGD("[{::^8}] Waited {} ms for {}", client_,
+      std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), request.target());
   }
 
   // Handle the case where the file doesn't exist.
   if (ec == beast::errc::no_such_file_or_directory) {
-    const auto response = not_found(request.target());
+    const auto response = error(http::status::not_found);
     LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    ec = {};
+    co_await write(response);
     co_return;
   }
 
   // Handle an unknown error.
   if (ec) {
-    const auto response = server_error(ec.message());
+    const auto response = error(http::status::internal_server_error);
     LOGW("[{::^8}] {:03d} {} {} ({})", client_, response.result(), request.method_string(), request.target(), ec.message());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    ec = {};
+    co_await write(response);
     co_return;
   }
 
   // Cache the size since we need it after the move.
   auto const size = body.size();
 
+  // Fields that depend on the type. The type takes precedence over the host for caching.
+  const auto& cache = type.cache.empty() ? host_->cache : type.cache;
+  std::string fields;
+  std::string_view extra = type.cache.empty() ? host_->cache_field : type.cache_field;
+  if (negotiate) {
+    fields = fmt::format("{}{}Vary: Accept-Encoding\r\n", extra, gzip ? "Content-Encoding: gzip\r\n" : "");
+    extra = fields;
+  }
+
   // Respond to HEAD request.
   if (request.method() == http::verb::head) {
-    http::response<http::empty_body> response{ http::status::ok, request.version() };
-    response.set(http::field::server, SERVER_VERSION_STRING);
-    response.set(http::field::content_type, mime_type(file));
+    net::response response{ headers, http::status::ok, request.version(), request.keep_alive(), type };
+    response.set(extra);
     response.content_length(size);
-    response.keep_alive(request.keep_alive());
     LOGD("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-    co_await http::async_write(stream_, response, asio::use_awaitable);
+    co_await write(response);
+    co_return;
+  }
+
+  // Throttle the body to the client bandwidth.
+  if (route && route->bandwidth) {
+    net::response response{ headers, http::status::ok, request.version(), request.keep_alive(), type };
+    response.set(extra);
+    response.content_length(size);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await pace(response, body.file(), size, *route);
     co_return;
   }
 
+#ifdef __linux__
+  // Send large files without copying them through a buffer.
+  if (type.sendfile && mime.sendfile && size >= mime.sendfile) {
+    net::response response{ headers, http::status::ok, request.version(), request.keep_alive(), type };
+    response.set(extra);
+    response.content_length(size);
+    LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
+    co_await send(response, body.file(), size);
+    co_return;
+  }
+#endif
+
   // Respond to GET request.
   http::response<http::file_body> response{
     std::piecewise_construct,
@@ -238,29 +1050,22 @@ auto session::handle(const http::request<http::string_body>& request, beast::err
     std::make_tuple(http::status::ok, request.version()),
   };
   response.set(http::field::server, SERVER_VERSION_STRING);
-  response.set(http::field::content_type, mime_type(file));
+  response.set(http::field::date, headers.date_value());
+  response.set(http::field::content_type, type.name);
+  if (!cache.empty()) {
+    response.set(http::field::cache_control, cache);
+  }
+  if (negotiate) {
+    if (gzip) {
+      response.set(http::field::content_encoding, "gzip");
+    }
+    response.set(http::field::vary, "Accept-Encoding");
+  }
   response.content_length(size);
   response.keep_alive(request.keep_alive());
   LOGI("[{::^8}] {:03d} {} {}", client_, response.result(), request.method_string(), request.target());
-  co_await http::async_write(stream_, response, asio::use_awaitable);
+  co_await write(response);
   co_return;
 }
 
-void session::client(const asio::ip::address& address)
-{
-  if (address.is_v4()) {
-    client_ = fmt::format("{:08X}", address.to_v4().to_ulong());
-  } else if (address.is_v6()) {
-    // clang-format off
-    const auto bytes = address.to_v6().to_bytes();
-    client_ = fmt::format(
-      "{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}",
-      bytes[0x0], bytes[0x1], bytes[0x2], bytes[0x3], bytes[0x4], bytes[0x5], bytes[0x6], bytes[0x7],
-      bytes[0x8], bytes[0x9], bytes[0xA], bytes[0xB], bytes[0xC], bytes[0xD], bytes[0xE], bytes[0xF]);
-    // clang-format on
-  } else {
-    client_ = address.to_string();
-  }
-}
-
 }  // namespace net
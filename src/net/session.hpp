@@ -5,14 +5,60 @@ namespace net {
 
 class session {
 public:
-  session(net::server& server, asio::ip::tcp::socket socket);
+  session(net::server& server, asio::ip::tcp::socket socket, const asio::ip::address& address);
+
+  session(session&& other) = default;
+  session(const session& other) = delete;
+  session& operator=(session&& other) = delete;
+  session& operator=(const session& other) = delete;
+
+  ~session();
 
   auto operator()() noexcept -> asio::awaitable<void>;
 
+  auto read(http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>;
+
+  // Handles a request and records it, also when the connection is closed after the response.
+  auto serve(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>;
+
   auto handle(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>;
-  void client(const asio::ip::address& address);
 
-  std::string_view client() noexcept
+  auto upload(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>;
+  auto proxy(const http::request<http::string_body>& request, net::upstream::route& route, beast::error_code& ec)
+    -> asio::awaitable<void>;
+  auto cached(const http::request<http::string_body>& request, net::upstream::route& route,
+    const net::cache::route& rule) -> asio::awaitable<bool>;
+  auto store(const http::request<http::string_body>& request) -> asio::awaitable<void>;
+  auto events(const http::request<http::string_body>& request, beast::error_code& ec) -> asio::awaitable<void>;
+  auto upgrade(const http::request<http::string_body>& request) -> asio::awaitable<void>;
+
+  template <typename Message>
+    requires(!std::is_same_v<std::remove_const_t<Message>, net::response>)
+  auto write(Message& message) -> asio::awaitable<void>
+  {
+    trace_.mark(net::phase::handled);
+    status_ = static_cast<unsigned>(message.result());
+    beast::error_code ec;
+    bytes_ += co_await http::async_write(stream_, message, asio::redirect_error(asio::use_awaitable, ec));
+    if (ec && ec != http::error::end_of_stream) {
+      throw boost::system::system_error(ec);
+    }
+    trace_.mark(net::phase::written);
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+  }
+
+  auto write(const net::response& response) -> asio::awaitable<void>;
+
+  // Writes the header and the file body in chunks that are paced to the bandwidth of the route.
+  auto pace(const net::response& response, beast::file& file, std::uint64_t size, const net::limiter::route& route)
+    -> asio::awaitable<void>;
+
+  // Writes the header and sends the file body from the page cache.
+  auto send(const net::response& response, beast::file& file, std::uint64_t size) -> asio::awaitable<void>;
+
+  const net::client& client() const noexcept
   {
     return client_;
   }
@@ -29,11 +75,20 @@ public:
 
 private:
   bool close_on_error(beast::error_code& ec, const char* what = nullptr);
+  void resolve(const http::request<http::string_body>& request) noexcept;
+  void finish(const http::request<http::string_body>& request);
 
   net::server& server_;
   beast::tcp_stream stream_;
   beast::flat_buffer buffer_;
-  std::string client_ = "CLIENT";
+  std::weak_ptr<net::server::buffers> buffers_;
+  std::unique_ptr<http::request_parser<http::empty_body>> pending_;
+  net::client client_;
+  const net::host* host_ = nullptr;
+  std::uint64_t connection_ = 0;
+  net::trace trace_;
+  unsigned status_ = 0;
+  std::uint64_t bytes_ = 0;
 };
 
 }  // namespace net
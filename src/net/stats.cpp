@@ -0,0 +1,42 @@
+#include "stats.hpp"
+#include <algorithm>
+
+namespace net {
+
+json::object stats::report() const
+{
+  std::uint64_t connections = 0;
+  std::uint64_t requests = 0;
+  std::uint64_t bytes = 0;
+  std::array<std::uint64_t, 5> status{};
+  std::uint64_t waits = 0;
+  std::uint64_t timeouts = 0;
+  std::uint64_t wait_total = 0;
+  std::uint64_t wait_max = 0;
+  for (const auto& slot : slots_) {
+    connections += slot.connections.load(std::memory_order_relaxed);
+    requests += slot.requests.load(std::memory_order_relaxed);
+    bytes += slot.bytes.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < status.size(); i++) {
+      status[i] += slot.status[i].load(std::memory_order_relaxed);
+    }
+    waits += slot.waits.load(std::memory_order_relaxed);
+    timeouts += slot.timeouts.load(std::memory_order_relaxed);
+    wait_total += slot.wait_total.load(std::memory_order_relaxed);
+    wait_max = std::max(wait_max, slot.wait_max.load(std::memory_order_relaxed));
+  }
+  json::object codes;
+  for (std::size_t i = 0; i < status.size(); i++) {
+    codes[fmt::format("{}xx", i + 1)] = status[i];
+  }
+  return {
+    { "connections", connections },
+    { "requests", requests },
+    { "bytes", bytes },
+    { "status", std::move(codes) },
+    { "wait", { { "waits", waits }, { "timeouts", timeouts }, { "total_us", wait_total }, { "max_us", wait_max } } },
+    { "restarts", restarts_.load(std::memory_order_relaxed) },
+  };
+}
+
+}  // namespace net
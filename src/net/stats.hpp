@@ -0,0 +1,75 @@
+#pragma once
+#include <common.hpp>
+#include <array>
+#include <atomic>
+
+namespace net {
+
+// Request counters that may be placed in memory shared by worker processes.
+// Every process only writes its own cache lines, so counters are updated without atomic read-modify-write
+// instructions or contention and summed when they are read.
+class stats {
+public:
+  static constexpr std::size_t slot_count = 64;
+
+  struct alignas(64) slot {
+    std::atomic<std::uint64_t> connections{ 0 };
+    std::atomic<std::uint64_t> requests{ 0 };
+    std::atomic<std::uint64_t> bytes{ 0 };
+    std::array<std::atomic<std::uint64_t>, 5> status{};
+    std::atomic<std::uint64_t> waits{ 0 };
+    std::atomic<std::uint64_t> timeouts{ 0 };
+    std::atomic<std::uint64_t> wait_total{ 0 };
+    std::atomic<std::uint64_t> wait_max{ 0 };
+
+    // Counts a response. Must only be called by the owner of the slot.
+    void record(unsigned code, std::uint64_t size) noexcept
+    {
+      add(requests, 1);
+      add(bytes, size);
+      if (code >= 100 && code < 600) {
+        add(status[code / 100 - 1], 1);
+      }
+    }
+
+    // Counts a wait in microseconds for a file that was being written. Must only be called by the owner of the slot.
+    void wait(std::uint64_t us, bool success) noexcept
+    {
+      add(waits, 1);
+      if (!success) {
+        add(timeouts, 1);
+      }
+      add(wait_total, us);
+      if (us > wait_max.load(std::memory_order_relaxed)) {
+        wait_max.store(us, std::memory_order_relaxed);
+      }
+    }
+
+    static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+  };
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+  slot& operator[](std::size_t worker) noexcept
+  {
+    return slots_[worker];
+  }
+
+  // Counts a worker process that was restarted by the master process.
+  void restart() noexcept
+  {
+    restarts_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Returns the sum of all slots.
+  json::object report() const;
+
+private:
+  std::array<slot, slot_count> slots_;
+  std::atomic<std::uint64_t> restarts_{ 0 };
+};
+
+}  // namespace net
@@ -0,0 +1,68 @@
+#include "stream.hpp"
+
+namespace net {
+
+stream::stream(beast::tcp_stream& socket, http::status status, unsigned version, std::string_view content_type) :
+  socket_(socket), response_(status, version), serializer_(response_)
+{
+  response_.set(http::field::content_type, content_type);
+  response_.set(http::field::cache_control, "no-cache");
+  if (version > 10) {
+    response_.chunked(true);
+  } else {
+    response_.keep_alive(false);
+  }
+  response_.body().data = nullptr;
+  response_.body().more = true;
+}
+
+auto stream::begin(beast::error_code& ec) -> asio::awaitable<void>
+{
+  co_await http::async_write_header(socket_, serializer_, asio::redirect_error(asio::use_awaitable, ec));
+}
+
+auto stream::write(std::string_view data, beast::error_code& ec) -> asio::awaitable<void>
+{
+  if (data.empty()) {
+    co_return;
+  }
+  response_.body().data = const_cast<char*>(data.data());
+  response_.body().size = data.size();
+  response_.body().more = true;
+  co_await http::async_write(socket_, serializer_, asio::redirect_error(asio::use_awaitable, ec));
+  if (ec == http::error::need_buffer) {
+    ec = {};
+  }
+}
+
+auto stream::event(std::string_view data, std::string_view type, beast::error_code& ec) -> asio::awaitable<void>
+{
+  frame_.clear();
+  if (!type.empty()) {
+    frame_.append("event: ");
+    frame_.append(type);
+    frame_.push_back('\n');
+  }
+  while (true) {
+    const auto pos = data.find('\n');
+    frame_.append("data: ");
+    frame_.append(data.substr(0, pos));
+    frame_.push_back('\n');
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    data.remove_prefix(pos + 1);
+  }
+  frame_.push_back('\n');
+  co_await write(frame_, ec);
+}
+
+auto stream::end(beast::error_code& ec) -> asio::awaitable<void>
+{
+  response_.body().data = nullptr;
+  response_.body().size = 0;
+  response_.body().more = false;
+  co_await http::async_write(socket_, serializer_, asio::redirect_error(asio::use_awaitable, ec));
+}
+
+}  // namespace net
@@ -0,0 +1,42 @@
+#pragma once
+#include <common.hpp>
+
+namespace net {
+
+// Streaming response that writes every chunk as soon as it is produced.
+// HTTP/1.1 responses use chunked encoding; HTTP/1.0 responses are terminated by closing the connection.
+// Each write completes when the socket accepted the data, which ties the producer to the client.
+class stream {
+public:
+  stream(beast::tcp_stream& socket, http::status status, unsigned version, std::string_view content_type);
+
+  stream(stream&& other) = delete;
+  stream(const stream& other) = delete;
+  stream& operator=(stream&& other) = delete;
+  stream& operator=(const stream& other) = delete;
+
+  http::response<http::buffer_body>& response() noexcept
+  {
+    return response_;
+  }
+
+  // Writes the header.
+  auto begin(beast::error_code& ec) -> asio::awaitable<void>;
+
+  // Writes a chunk.
+  auto write(std::string_view data, beast::error_code& ec) -> asio::awaitable<void>;
+
+  // Writes a server-sent event.
+  auto event(std::string_view data, std::string_view type, beast::error_code& ec) -> asio::awaitable<void>;
+
+  // Writes the last chunk.
+  auto end(beast::error_code& ec) -> asio::awaitable<void>;
+
+private:
+  beast::tcp_stream& socket_;
+  http::response<http::buffer_body> response_;
+  http::response_serializer<http::buffer_body> serializer_;
+  std::string frame_;
+};
+
+}  // namespace net
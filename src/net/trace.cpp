@@ -0,0 +1,112 @@
+#include "trace.hpp"
+#include <spdlog/async.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+namespace net {
+namespace {
+
+constexpr std::array<std::string_view, static_cast<std::size_t>(phase::count)> phase_names{
+  "accept",
+  "idle",
+  "read",
+  "handle",
+  "write",
+};
+
+}  // namespace
+
+tracer::tracer(const app::config& config) :
+  slow_(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(config.trace.slow).count())),
+  sample_(config.trace.sample), base_ticks_(ticks()), base_time_(std::chrono::steady_clock::now())
+{
+  if (sample_ && config.trace.filename) {
+    // Append to the traces of a previous run, which already started the array.
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(*config.trace.filename, ec);
+    logger_ = spdlog::create_async<spdlog::sinks::basic_file_sink_mt>("trace", config.trace.filename->string(), false);
+    logger_->set_pattern("%v");
+    logger_->set_level(spdlog::level::info);
+    if (ec || !size) {
+      logger_->info("[");
+    }
+  }
+}
+
+tracer::~tracer()
+{
+  if (logger_) {
+    logger_->flush();
+    spdlog::drop(logger_->name());
+  }
+}
+
+void tracer::finish(const trace& trace, std::uint64_t connection, const net::client& client, unsigned status,
+  std::string_view method, std::string_view target)
+{
+  const auto sampled = logger_ && count_.fetch_add(1, std::memory_order_relaxed) % sample_ == 0;
+  if (!slow_ && !sampled) {
+    return;
+  }
+
+  const auto us = [this](std::uint64_t from, std::uint64_t to) {
+    return elapsed(from, to);
+  };
+
+  // Requests start with their first byte. The time before it is reported as idle time of the connection.
+  const auto total = us(trace[phase::received], trace[phase::written]);
+  if (slow_ && total >= slow_) {
+    LOGW("[{::^8}] {:03d} {} {} took {:.3f} ms (read: {:.3f} ms, handle: {:.3f} ms, write: {:.3f} ms, idle: {:.3f} ms)",
+      client, status, method, target, total / 1000.0,
+      us(trace[phase::received], trace[phase::parsed]) / 1000.0,
+      us(trace[phase::parsed], trace[phase::handled]) / 1000.0,
+      us(trace[phase::handled], trace[phase::written]) / 1000.0,
+      us(trace[phase::accepted], trace[phase::received]) / 1000.0);
+  }
+
+  if (sampled) {
+    const auto start = us(base_ticks_, trace[phase::received]);
+    logger_->info("{},", json::to_string(json::object{
+      { "name", target },
+      { "cat", "request" },
+      { "ph", "X" },
+      { "ts", start },
+      { "dur", total },
+      { "pid", 1 },
+      { "tid", connection },
+      { "args", json::object{ { "client", fmt::to_string(client) }, { "method", method }, { "status", status } } },
+    }));
+    for (std::size_t i = 1; i < trace.ticks.size(); i++) {
+      logger_->info("{},", json::to_string(json::object{
+        { "name", phase_names[i] },
+        { "cat", "phase" },
+        { "ph", "X" },
+        { "ts", us(base_ticks_, trace.ticks[i - 1]) },
+        { "dur", us(trace.ticks[i - 1], trace.ticks[i]) },
+        { "pid", 1 },
+        { "tid", connection },
+      }));
+    }
+  }
+}
+
+double tracer::frequency() noexcept
+{
+  if (const auto frequency = frequency_.load(std::memory_order_relaxed); frequency > 0.0) {
+    return frequency;
+  }
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  // Calibrate against the steady clock and keep the result once enough time has passed.
+  const auto elapsed = std::chrono::steady_clock::now() - base_time_;
+  const auto us = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(elapsed).count();
+  const auto frequency = us > 0.0 ? (ticks() - base_ticks_) / us : 1000.0;
+  if (elapsed >= std::chrono::seconds{ 1 }) {
+    frequency_.store(frequency, std::memory_order_relaxed);
+  }
+  return frequency;
+#else
+  frequency_.store(1000.0, std::memory_order_relaxed);
+  return 1000.0;
+#endif
+}
+
+}  // namespace net
@@ -0,0 +1,100 @@
+#pragma once
+#include <app/config.hpp>
+#include <net/client.hpp>
+#include <array>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace net {
+
+enum class phase : std::size_t {
+  accepted,  // connection accepted or previous response written
+  received,  // first byte of the request received
+  parsed,    // request headers parsed
+  handled,   // response ready to be written
+  written,   // last byte of the response written
+  count,
+};
+
+// Returns the current time in ticks.
+inline std::uint64_t ticks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  return __rdtsc();
+#else
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
+
+// Timestamps of a single request.
+struct trace {
+  std::array<std::uint64_t, static_cast<std::size_t>(phase::count)> ticks{};
+
+  void mark(phase phase) noexcept
+  {
+    ticks[static_cast<std::size_t>(phase)] = net::ticks();
+  }
+
+  void reset() noexcept
+  {
+    const auto accepted = ticks[static_cast<std::size_t>(phase::written)];
+    ticks = {};
+    ticks[static_cast<std::size_t>(phase::accepted)] = accepted;
+  }
+
+  std::uint64_t operator[](phase phase) const noexcept
+  {
+    return ticks[static_cast<std::size_t>(phase)];
+  }
+};
+
+// Reports slow requests and exports sampled requests in the chrome trace-event format.
+// Requests are measured from their first byte. The time a connection was idle before it is reported separately.
+class tracer {
+public:
+  tracer(const app::config& config);
+
+  tracer(tracer&& other) = delete;
+  tracer(const tracer& other) = delete;
+  tracer& operator=(tracer&& other) = delete;
+  tracer& operator=(const tracer& other) = delete;
+
+  ~tracer();
+
+  // Returns a new connection id.
+  std::uint64_t connection() noexcept
+  {
+    return connections_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void finish(const trace& trace, std::uint64_t connection, const net::client& client, unsigned status,
+    std::string_view method, std::string_view target);
+
+  // Returns the number of microseconds between two ticks or 0 if one of them is missing.
+  double elapsed(std::uint64_t from, std::uint64_t to) noexcept
+  {
+    return from && to > from ? (to - from) / frequency() : 0.0;
+  }
+
+private:
+  // Returns the number of ticks per microsecond.
+  double frequency() noexcept;
+
+  std::uint64_t slow_ = 0;
+  std::size_t sample_ = 0;
+  std::atomic<std::uint64_t> count_ = 0;
+  std::atomic<std::uint64_t> connections_ = 0;
+  std::shared_ptr<spdlog::logger> logger_;
+
+  std::uint64_t base_ticks_ = 0;
+  std::chrono::steady_clock::time_point base_time_;
+  std::atomic<double> frequency_ = 0.0;
+};
+
+}  // namespace net
@@ -0,0 +1,216 @@
+#include "types.hpp"
+#include <net/response.hpp>
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace net {
+namespace {
+
+constexpr std::size_t extension_size = 16;
+
+constexpr std::string_view default_type = "application/octet-stream";
+
+// clang-format off
+constexpr std::array<std::pair<std::string_view, std::string_view>, 35> builtin_types{ {
+  { "html",        "text/html" },
+  { "htm",         "text/html" },
+  { "css",         "text/css" },
+  { "js",          "application/javascript" },
+  { "mjs",         "application/javascript" },
+  { "json",        "application/json" },
+  { "map",         "application/json" },
+  { "webmanifest", "application/manifest+json" },
+  { "xml",         "application/xml" },
+  { "txt",         "text/plain" },
+  { "csv",         "text/csv" },
+  { "md",          "text/markdown" },
+  { "wasm",        "application/wasm" },
+  { "pdf",         "application/pdf" },
+  { "zip",         "application/zip" },
+  { "gz",          "application/gzip" },
+  { "gif",         "image/gif" },
+  { "jpeg",        "image/jpeg" },
+  { "jpg",         "image/jpeg" },
+  { "png",         "image/png" },
+  { "webp",        "image/webp" },
+  { "avif",        "image/avif" },
+  { "svg",         "image/svg+xml" },
+  { "ico",         "image/x-icon" },
+  { "bmp",         "image/bmp" },
+  { "ttf",         "font/ttf" },
+  { "otf",         "font/otf" },
+  { "woff",        "font/woff" },
+  { "woff2",       "font/woff2" },
+  { "mp4",         "video/mp4" },
+  { "webm",        "video/webm" },
+  { "mp3",         "audio/mpeg" },
+  { "ogg",         "audio/ogg" },
+  { "wav",         "audio/wav" },
+  { "flac",        "audio/flac" },
+} };
+// clang-format on
+
+// Returns true for types that are usually worth compressing.
+bool compressible(std::string_view name) noexcept
+{
+  constexpr std::array<std::string_view, 8> names{ "application/javascript", "application/json", "application/xml",
+    "application/wasm", "image/x-icon", "image/bmp", "font/ttf", "font/otf" };
+  return name.starts_with("text/") || name.ends_with("+json") || name.ends_with("+xml") ||
+    std::find(names.begin(), names.end(), name) != names.end();
+}
+
+std::uint32_t hash(std::string_view key, std::uint32_t seed) noexcept
+{
+  std::uint32_t hash = 0x811C9DC5 ^ seed;
+  for (const auto c : key) {
+    hash = (hash ^ static_cast<std::uint8_t>(c)) * 0x01000193;
+  }
+  // Mix the bits so that consecutive seeds give unrelated slots.
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6B;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+}  // namespace
+
+types::types(const app::config& config)
+{
+  std::unordered_map<std::string, std::size_t> names;
+  std::unordered_map<std::string, std::size_t> extensions;
+  const auto insert = [&](std::string extension, std::string_view name) -> type& {
+    auto [it, inserted] = names.emplace(name, types_.size());
+    if (inserted) {
+      auto& type = types_.emplace_back();
+      type.name = name;
+      type.compress = compressible(name);
+      type.sendfile = true;
+    }
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    // Lookups use the text after the last dot, so extensions that contain one are never found.
+    if (!extension.empty() && extension.size() <= extension_size && extension.find('.') == std::string::npos) {
+      extensions.insert_or_assign(std::move(extension), it->second);
+    }
+    return types_[it->second];
+  };
+
+  insert({}, default_type);
+  for (const auto& [extension, name] : builtin_types) {
+    insert(std::string{ extension }, name);
+  }
+
+  // Lines have a type followed by its extensions.
+  if (const auto& file = config.mime.file) {
+    std::ifstream is{ *file };
+    if (!is) {
+      throw std::runtime_error("Could not open mime types (" + file->string() + ")");
+    }
+    for (std::string line; std::getline(is, line);) {
+      std::istringstream ls{ line.substr(0, line.find('#')) };
+      std::string name;
+      ls >> name;
+      for (std::string extension; ls >> extension;) {
+        insert(std::move(extension), name);
+      }
+    }
+  }
+
+  for (const auto& entry : config.mime.types) {
+    auto& type = insert(entry.extension, entry.name);
+    type.compress = entry.compress.value_or(type.compress);
+    type.sendfile = entry.sendfile.value_or(type.sendfile);
+    if (entry.max_age) {
+      type.cache = fmt::format("max-age={}", entry.max_age->count());
+    }
+  }
+
+  for (auto& type : types_) {
+    type.fields = fmt::format("Server: {}\r\nContent-Type: {}\r\n", SERVER_VERSION_STRING, type.name);
+    if (!type.cache.empty()) {
+      type.cache_field = fmt::format("Cache-Control: {}\r\n", type.cache);
+    }
+  }
+  build({ extensions.begin(), extensions.end() });
+  LOGD("[:SERVER:] Loaded {} mime types for {} extensions", types_.size(), extensions.size());
+}
+
+const type& types::find(std::string_view path) const noexcept
+{
+  const auto dot = path.rfind('.');
+  if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos) {
+    return types_.front();
+  }
+  const auto extension = path.substr(dot + 1);
+  if (extension.empty() || extension.size() > extension_size) {
+    return types_.front();
+  }
+
+  // Compare lowercase extensions without allocating.
+  std::array<char, extension_size> buffer;
+  std::transform(extension.begin(), extension.end(), buffer.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  const auto key = std::string_view{ buffer.data(), extension.size() };
+  const auto seed = seeds_[hash(key, 0) & (seeds_.size() - 1)];
+  const auto& [name, index] = slots_[hash(key, seed) & (slots_.size() - 1)];
+  return name == key ? types_[index] : types_.front();
+}
+
+void types::build(const std::vector<std::pair<std::string, std::size_t>>& extensions)
+{
+  // Distribute the keys to buckets and place the largest buckets first, while most slots are free.
+  const auto mask = std::bit_ceil(extensions.size() * 2 + 1) - 1;
+  std::vector<std::vector<std::size_t>> buckets(std::bit_ceil(extensions.size() / 4 + 1));
+  for (std::size_t i = 0; i < extensions.size(); i++) {
+    buckets[hash(extensions[i].first, 0) & (buckets.size() - 1)].push_back(i);
+  }
+  std::vector<std::size_t> order(buckets.size());
+  for (std::size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&buckets](std::size_t a, std::size_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  // Find a seed for every bucket that moves all of its keys to free slots.
+  slots_.assign(mask + 1, {});
+  seeds_.assign(buckets.size(), 0);
+  std::vector<bool> used(slots_.size());
+  std::vector<std::size_t> slots;
+  for (const auto bucket : order) {
+    if (buckets[bucket].empty()) {
+      break;
+    }
+    for (std::uint32_t seed = 1;; seed++) {
+      if (seed == 0x100000) {
+        throw std::runtime_error("Could not build the mime type table");
+      }
+      slots.clear();
+      for (const auto i : buckets[bucket]) {
+        const auto slot = hash(extensions[i].first, seed) & mask;
+        if (used[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (slots.size() != buckets[bucket].size()) {
+        continue;
+      }
+      for (std::size_t i = 0; i < slots.size(); i++) {
+        used[slots[i]] = true;
+        slots_[slots[i]] = extensions[buckets[bucket][i]];
+      }
+      seeds_[bucket] = seed;
+      break;
+    }
+  }
+}
+
+}  // namespace net
@@ -0,0 +1,48 @@
+#pragma once
+#include <app/config.hpp>
+
+namespace net {
+
+// Content type with the policy for serving files of that type.
+struct type {
+  std::string name;
+
+  // Encoded Server and Content-Type fields.
+  std::string fields;
+
+  // Cache-Control field value and the encoded field, or empty strings to use the host setting.
+  std::string cache;
+  std::string cache_field;
+
+  // Files may be served from a precompressed "<file>.gz" sibling.
+  bool compress = false;
+
+  // Files may be sent with sendfile() instead of being read into a buffer.
+  bool sendfile = false;
+};
+
+// Table of content types by file extension, built once from the built-in types, an optional mime.types file
+// and the config, in that order of precedence.
+// Extensions are placed in a perfect hash table: a lookup hashes the extension twice, the second time with the
+// displacement of its bucket, and compares a single key. Unknown extensions resolve to the default type.
+class types {
+public:
+  types(const app::config& config);
+
+  types(types&& other) = delete;
+  types(const types& other) = delete;
+  types& operator=(types&& other) = delete;
+  types& operator=(const types& other) = delete;
+
+  // Returns the type for the extension of a path.
+  const type& find(std::string_view path) const noexcept;
+
+private:
+  void build(const std::vector<std::pair<std::string, std::size_t>>& extensions);
+
+  std::vector<type> types_;
+  std::vector<std::pair<std::string, std::size_t>> slots_;
+  std::vector<std::uint32_t> seeds_;
+};
+
+}  // namespace net
@@ -0,0 +1,162 @@
+#include "upstream.hpp"
+#include <algorithm>
+
+namespace net {
+
+upstream::upstream(const app::config& config, executor_type executor) :
+  executor_(executor), connections_(config.upstream.connections), timeout_(config.upstream.timeout),
+  fail_timeout_(config.upstream.fail_timeout), least_outstanding_(config.upstream.least_outstanding)
+{
+  asio::ip::tcp::resolver resolver{ executor };
+  for (const auto& config_route : config.upstream.routes) {
+    auto& route = routes_.emplace_back();
+    route.prefix = config_route.prefix;
+    for (const auto& name : config_route.backends) {
+      const auto pos = name.rfind(':');
+      auto host = name.substr(0, pos);
+      if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+      }
+      auto& backend = route.backends.emplace_back();
+      backend.name = name;
+      backend.endpoint = resolver.resolve(host, name.substr(pos + 1))->endpoint();
+      LOGD("[UPSTREAM] {} -> {}", route.prefix, backend.name);
+    }
+  }
+
+  // Prefer longer prefixes.
+  std::sort(routes_.begin(), routes_.end(), [](const route& lhs, const route& rhs) {
+    return lhs.prefix.size() > rhs.prefix.size();
+  });
+}
+
+auto upstream::match(std::string_view target) noexcept -> route*
+{
+  for (auto& route : routes_) {
+    if (target.starts_with(route.prefix)) {
+      return &route;
+    }
+  }
+  return nullptr;
+}
+
+auto upstream::connect(route& route, bool pooled) -> asio::awaitable<connection>
+{
+  for (std::size_t attempt = 0; attempt < route.backends.size(); attempt++) {
+    connection result;
+    result.origin = select(route);
+    auto& backend = *result.origin;
+    if (pooled && !backend.idle.empty()) {
+      result.stream = std::move(backend.idle.back());
+      result.reused = true;
+      backend.idle.pop_back();
+      backend.outstanding++;
+      co_return result;
+    }
+
+    result.stream = std::make_unique<beast::tcp_stream>(executor_);
+    result.stream->expires_after(timeout_);
+    boost::system::error_code ec;
+    backend.outstanding++;
+    co_await result.stream->async_connect(backend.endpoint, asio::redirect_error(asio::use_awaitable, ec));
+    if (!ec) {
+      result.stream->socket().set_option(asio::ip::tcp::no_delay{ true }, ec);
+      co_return result;
+    }
+    LOGW("[UPSTREAM] {}: {} ({})", backend.name, ec.message(), ec.value());
+    fail(result);
+  }
+  co_return connection{};
+}
+
+void upstream::release(connection& connection, bool reusable) noexcept
+{
+  if (!connection.origin) {
+    return;
+  }
+  auto& backend = *connection.origin;
+  backend.outstanding--;
+  if (reusable && connection.stream && backend.idle.size() < connections_) {
+    connection.stream->expires_never();
+    backend.idle.push_back(std::move(connection.stream));
+  }
+  connection.stream.reset();
+  connection.origin = nullptr;
+}
+
+void upstream::fail(connection& connection) noexcept
+{
+  if (!connection.origin) {
+    return;
+  }
+  auto& backend = *connection.origin;
+  backend.down = clock::now() + fail_timeout_;
+  backend.idle.clear();
+  release(connection, false);
+}
+
+auto upstream::fetch(route& route, http::request<http::empty_body> request, std::size_t limit)
+  -> asio::awaitable<std::shared_ptr<http::response<http::string_body>>>
+{
+  for (std::size_t attempt = 0; true; attempt++) {
+    auto connection = co_await connect(route);
+    if (!connection.stream) {
+      co_return nullptr;
+    }
+    connection.stream->expires_after(timeout_);
+    boost::system::error_code ec;
+    co_await http::async_write(*connection.stream, request, asio::redirect_error(asio::use_awaitable, ec));
+    http::response_parser<http::string_body> parser;
+    parser.body_limit(limit);
+    parser.skip(request.method() == http::verb::head);
+    if (!ec) {
+      co_await http::async_read(*connection.stream, connection.buffer, parser,
+        asio::redirect_error(asio::use_awaitable, ec));
+    }
+    if (ec && connection.reused && attempt == 0) {
+      release(connection, false);
+      continue;
+    }
+    if (ec) {
+      LOGW("[UPSTREAM] {}: {} ({})", connection.origin->name, ec.message(), ec.value());
+      if (ec == http::error::body_limit) {
+        release(connection, false);
+      } else {
+        fail(connection);
+      }
+      co_return nullptr;
+    }
+    auto response = parser.release();
+    release(connection, response.keep_alive() && connection.buffer.size() == 0);
+    co_return std::make_shared<http::response<http::string_body>>(std::move(response));
+  }
+}
+
+auto upstream::select(route& route) noexcept -> backend*
+{
+  // Skip failed backends unless all of them failed, then use the one that failed first.
+  const auto now = clock::now();
+  const auto count = route.backends.size();
+  const auto start = route.next++ % count;
+  backend* result = nullptr;
+  for (std::size_t i = 0; i < count; i++) {
+    auto& backend = route.backends[(start + i) % count];
+    if (backend.down > now) {
+      continue;
+    }
+    if (!least_outstanding_) {
+      return &backend;
+    }
+    if (!result || backend.outstanding < result->outstanding) {
+      result = &backend;
+    }
+  }
+  if (!result) {
+    result = &*std::min_element(route.backends.begin(), route.backends.end(), [](const auto& lhs, const auto& rhs) {
+      return lhs.down < rhs.down;
+    });
+  }
+  return result;
+}
+
+}  // namespace net
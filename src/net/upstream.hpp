@@ -0,0 +1,82 @@
+#pragma once
+#include <app/config.hpp>
+
+namespace net {
+
+// Reverse-proxy routes with pools of keep-alive backend connections.
+// Backends are selected round-robin or by the least number of outstanding requests. A backend that fails to
+// connect or to respond is skipped until the fail timeout expires. Must only be used from the server executor.
+class upstream {
+public:
+  using executor_type = asio::steady_timer::executor_type;
+  using clock = std::chrono::steady_clock;
+
+  struct backend {
+    std::string name;
+    asio::ip::tcp::endpoint endpoint;
+    std::size_t outstanding = 0;
+    clock::time_point down;
+    std::vector<std::unique_ptr<beast::tcp_stream>> idle;
+  };
+
+  struct route {
+    std::string prefix;
+    std::vector<backend> backends;
+    std::size_t next = 0;
+  };
+
+  // Connection to a backend that is returned to the pool by release().
+  struct connection {
+    std::unique_ptr<beast::tcp_stream> stream;
+    beast::flat_buffer buffer;
+    backend* origin = nullptr;
+    bool reused = false;
+  };
+
+  upstream(const app::config& config, executor_type executor);
+
+  upstream(upstream&& other) = delete;
+  upstream(const upstream& other) = delete;
+  upstream& operator=(upstream&& other) = delete;
+  upstream& operator=(const upstream& other) = delete;
+
+  bool empty() const noexcept
+  {
+    return routes_.empty();
+  }
+
+  std::chrono::milliseconds timeout() const noexcept
+  {
+    return timeout_;
+  }
+
+  // Returns the route with the longest matching prefix.
+  route* match(std::string_view target) noexcept;
+
+  // Returns a pooled or new connection. Returns a connection without a stream if no backend could be reached.
+  // Requests that cannot be sent again should not use pooled connections, which the backend may have closed.
+  auto connect(route& route, bool pooled = true) -> asio::awaitable<connection>;
+
+  // Returns the connection to the pool if it can be reused.
+  void release(connection& connection, bool reusable) noexcept;
+
+  // Marks the backend of the connection as failed and closes the connection.
+  void fail(connection& connection) noexcept;
+
+  // Sends a request without a body and reads the whole response. Returns nullptr if the request failed or the
+  // response body exceeded the limit.
+  auto fetch(route& route, http::request<http::empty_body> request, std::size_t limit)
+    -> asio::awaitable<std::shared_ptr<http::response<http::string_body>>>;
+
+private:
+  backend* select(route& route) noexcept;
+
+  executor_type executor_;
+  std::vector<route> routes_;
+  std::size_t connections_ = 16;
+  std::chrono::milliseconds timeout_;
+  std::chrono::milliseconds fail_timeout_;
+  bool least_outstanding_ = true;
+};
+
+}  // namespace net
@@ -0,0 +1,251 @@
+#include <net/access.hpp>
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+#include <version.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Read-only view of a whole file.
+class mapping {
+public:
+  mapping(const std::filesystem::path& filename)
+  {
+#ifndef _WIN32
+    const auto handle = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (handle == -1) {
+      throw std::system_error(errno, std::generic_category(), "Could not open " + filename.string());
+    }
+    size_ = std::filesystem::file_size(filename);
+    if (size_) {
+      const auto data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, handle, 0);
+      if (data == MAP_FAILED) {
+        const auto code = errno;
+        ::close(handle);
+        throw std::system_error(code, std::generic_category(), "Could not map " + filename.string());
+      }
+      ::madvise(data, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(data);
+    }
+    ::close(handle);
+#else
+    std::ifstream file{ filename, std::ios::binary };
+    if (!file) {
+      throw std::runtime_error("Could not open " + filename.string());
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+  }
+
+  mapping(mapping&& other) = delete;
+  mapping(const mapping& other) = delete;
+  mapping& operator=(mapping&& other) = delete;
+  mapping& operator=(const mapping& other) = delete;
+
+  ~mapping()
+  {
+#ifndef _WIN32
+    if (data_) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+  }
+
+  const char* data() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _WIN32
+  std::string buffer_;
+#endif
+};
+
+template <typename T>
+const T* column(const char* block, net::access::column column, std::size_t count) noexcept
+{
+  return reinterpret_cast<const T*>(block + sizeof(net::access::header) + net::access::offset(column, count));
+}
+
+struct statistics {
+  std::uint64_t requests = 0;
+  std::uint64_t bytes = 0;
+  std::int64_t first = std::numeric_limits<std::int64_t>::max();
+  std::int64_t last = std::numeric_limits<std::int64_t>::min();
+  std::array<std::uint64_t, 1000> status{};
+  std::vector<std::uint32_t> latency;
+  std::unordered_map<std::string, std::uint64_t> targets;
+};
+
+// Aggregates all blocks of a file. Every aggregation is a tight loop over a single column.
+void scan(const std::filesystem::path& filename, statistics& stats)
+{
+  const mapping file{ filename };
+  std::vector<std::string_view> names;
+  std::vector<std::uint64_t> hits;
+  std::size_t pos = 0;
+  while (pos + sizeof(net::access::header) <= file.size()) {
+    net::access::header header;
+    std::memcpy(&header, file.data() + pos, sizeof(header));
+    if (header.magic != net::access::magic || header.size < sizeof(header) || pos + header.size > file.size()) {
+      std::cerr << filename.string() << ": invalid block at offset " << pos << std::endl;
+      break;
+    }
+    const auto block = file.data() + pos;
+    const auto count = header.count;
+
+    // Target names. Target ids are only valid within a block.
+    names.clear();
+    auto entry = block + sizeof(header) + net::access::offset(net::access::column::count, count);
+    for (std::uint32_t i = 0; i < header.names; i++) {
+      net::access::name name;
+      std::memcpy(&name, entry, sizeof(name));
+      if (names.size() <= name.id) {
+        names.resize(name.id + 1);
+      }
+      names[name.id] = std::string_view{ entry + sizeof(name), name.size };
+      entry += sizeof(name) + net::access::align(name.size);
+    }
+
+    const auto time = column<std::int64_t>(block, net::access::column::time, count);
+    const auto bytes = column<std::uint64_t>(block, net::access::column::bytes, count);
+    const auto latency = column<std::uint32_t>(block, net::access::column::latency, count);
+    const auto target = column<std::uint32_t>(block, net::access::column::target, count);
+    const auto status = column<std::uint16_t>(block, net::access::column::status, count);
+
+    stats.requests += count;
+    stats.bytes = std::accumulate(bytes, bytes + count, stats.bytes);
+    if (count) {
+      stats.first = std::min(stats.first, *std::min_element(time, time + count));
+      stats.last = std::max(stats.last, *std::max_element(time, time + count));
+    }
+    for (std::uint32_t i = 0; i < count; i++) {
+      stats.status[std::min<std::size_t>(status[i], stats.status.size() - 1)]++;
+    }
+    stats.latency.insert(stats.latency.end(), latency, latency + count);
+    hits.assign(names.size() + 1, 0);
+    for (std::uint32_t i = 0; i < count; i++) {
+      hits[std::min<std::size_t>(target[i], names.size())]++;
+    }
+    for (std::size_t id = 0; id < hits.size(); id++) {
+      if (!hits[id]) {
+        continue;
+      }
+      if (id < names.size()) {
+        stats.targets[std::string(names[id])] += hits[id];
+      } else {
+        stats.targets["(other)"] += hits[id];
+      }
+    }
+    pos += header.size;
+  }
+}
+
+void print(statistics& stats, std::size_t top)
+{
+  if (!stats.requests) {
+    fmt::print("no requests\n");
+    return;
+  }
+  const auto seconds = std::max<double>((stats.last - stats.first) / 1e6, 1.0);
+  fmt::print("requests: {} ({:.1f}/s)\n", stats.requests, stats.requests / seconds);
+  fmt::print("bytes:    {} ({:.1f}/request)\n", stats.bytes, static_cast<double>(stats.bytes) / stats.requests);
+
+  fmt::print("\nstatus:\n");
+  for (std::size_t i = 0; i < stats.status.size(); i++) {
+    if (stats.status[i]) {
+      fmt::print("  {:03d} {:>12} {:6.2f}%\n", i, stats.status[i], stats.status[i] * 100.0 / stats.requests);
+    }
+  }
+
+  fmt::print("\nlatency:\n");
+  auto& latency = stats.latency;
+  for (const auto percentile : { 50.0, 90.0, 99.0, 99.9 }) {
+    const auto n = static_cast<std::size_t>(percentile / 100.0 * (latency.size() - 1));
+    std::nth_element(latency.begin(), latency.begin() + n, latency.end());
+    fmt::print("  p{:<5} {:>10.3f} ms\n", percentile, latency[n] / 1000.0);
+  }
+  fmt::print("  max    {:>10.3f} ms\n", *std::max_element(latency.begin(), latency.end()) / 1000.0);
+
+  fmt::print("\ntargets:\n");
+  std::vector<std::pair<std::string_view, std::uint64_t>> targets(stats.targets.begin(), stats.targets.end());
+  const auto end = targets.begin() + std::min(top, targets.size());
+  std::partial_sort(targets.begin(), end, targets.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second > rhs.second;
+  });
+  for (auto it = targets.begin(); it != end; ++it) {
+    fmt::print("  {:>12} {}\n", it->second, it->first);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  try {
+    namespace po = boost::program_options;
+
+    // clang-format off
+    po::options_description desc("usage: " PROJECT_NAME "-access [options] file...\n\navailable options");
+    desc.add_options()
+      ("help", "show this help message")
+      ("top", po::value<std::size_t>()->default_value(10), "number of most requested targets to show")
+      ("file", po::value<std::vector<std::string>>(), "binary access log file");
+    // clang-format on
+
+    po::positional_options_description positional;
+    positional.add("file", -1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || !vm.count("file")) {
+      std::cerr << desc << std::endl;
+      return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    statistics stats;
+    for (const auto& file : vm["file"].as<std::vector<std::string>>()) {
+      scan(file, stats);
+    }
+    print(stats, vm["top"].as<std::size_t>());
+  }
+  catch (const std::system_error& e) {
+    fmt::print(stderr, "{}: {} ({})\n", e.code().category().name(), e.what(), e.code().value());
+    return e.code().value();
+  }
+  catch (const std::exception& e) {
+    fmt::print(stderr, "error: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
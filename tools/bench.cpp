@@ -0,0 +1,133 @@
+#include <net/response.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+
+constexpr std::string_view body = R"({"status":"ok","name":"bench","values":[1,2,3,4,5,6,7,8]})";
+
+// Copies a buffer sequence the way a socket write would and returns the number of bytes.
+template <typename Buffers>
+std::size_t copy(const Buffers& buffers, std::array<char, 4096>& output)
+{
+  return asio::buffer_copy(asio::buffer(output), buffers);
+}
+
+// Runs a benchmark and prints the time per iteration.
+template <typename Function>
+void run(std::string_view name, std::size_t iterations, Function function)
+{
+  std::size_t size = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; i++) {
+    size += function();
+  }
+  const auto duration = std::chrono::steady_clock::now() - start;
+  const auto ns = std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+  fmt::print("{:<16} {:>8.1f} ns/response {:>8} bytes/response\n", name, ns, size / iterations);
+}
+
+// Sends sequential requests over one keep-alive connection to a running server and prints the latency.
+int latency(const char* host, const char* service, std::string_view target, std::size_t requests)
+{
+  asio::io_context context;
+  asio::ip::tcp::socket socket{ context };
+  asio::connect(socket, asio::ip::tcp::resolver{ context }.resolve(host, service));
+  socket.set_option(asio::ip::tcp::no_delay(true));
+
+  http::request<http::empty_body> request{ http::verb::get, target, 11 };
+  request.set(http::field::host, host);
+  request.keep_alive(true);
+
+  beast::flat_buffer buffer;
+  std::vector<double> latency;
+  latency.reserve(requests);
+  std::size_t size = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < requests; i++) {
+    const auto sent = std::chrono::steady_clock::now();
+    http::write(socket, request);
+    http::response_parser<http::string_body> parser;
+    parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+    http::read(socket, buffer, parser);
+    latency.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+    size += parser.get().body().size();
+  }
+  const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(latency.begin(), latency.end());
+  fmt::print("{} {} bytes/response {:.0f} requests/s\n", target, size / requests, requests / duration);
+  for (const auto percentile : { 50.0, 90.0, 99.0 }) {
+    const auto n = static_cast<std::size_t>(percentile / 100.0 * static_cast<double>(requests - 1));
+    fmt::print("  p{:<5} {:>10.1f} us\n", percentile, latency[n]);
+  }
+  fmt::print("  max    {:>10.1f} us\n", latency.back());
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+// Compares pre-encoded net::response buffers with http::response serialization for a small JSON response.
+// With a host, service and target, measures the request latency of a running server instead.
+int main(int argc, char* argv[])
+{
+  if (argc > 3) {
+    const auto requests = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 10'000;
+    if (!requests) {
+      fmt::print(stderr, "usage: {} <host> <service> <target> [requests]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    try {
+      return latency(argv[1], argv[2], argv[3], requests);
+    }
+    catch (const std::exception& e) {
+      fmt::print(stderr, "error: {}\n", e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  if (!iterations) {
+    fmt::print(stderr, "usage: {} [iterations]\n       {} <host> <service> <target> [requests]\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const net::headers headers;
+  std::array<char, 4096> output;
+
+  run("net::response", iterations, [&]() {
+    net::response response{ headers, http::status::ok, 11, true, "application/json" };
+    response.body(std::string{ body });
+    return copy(response.buffers(), output);
+  });
+
+  run("http::response", iterations, [&]() {
+    http::response<http::string_body> response{ http::status::ok, 11 };
+    response.set(http::field::server, SERVER_VERSION_STRING);
+    response.set(http::field::content_type, "application/json");
+    response.set(http::field::date, headers.date_value());
+    response.keep_alive(true);
+    response.body() = body;
+    response.prepare_payload();
+
+    std::size_t size = 0;
+    http::serializer<false, http::string_body> serializer{ response };
+    beast::error_code ec;
+    while (!ec && !serializer.is_done()) {
+      serializer.next(ec, [&](beast::error_code&, const auto& buffers) {
+        const auto bytes = asio::buffer_copy(asio::buffer(output) + size, buffers);
+        size += bytes;
+        serializer.consume(bytes);
+      });
+    }
+    return size;
+  });
+}